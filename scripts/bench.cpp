@@ -0,0 +1,264 @@
+// Microbenchmarks of the reconstruction hot paths
+//
+// usage: Benchmark [--fandisk path] [--sizes n,n,...] [--min_time s] [--filter name] [--tmp dir]
+//
+// Cases are run on fandisk and on synthetic clouds (sphere, torus, noisy plane) of each size. Every
+// case is repeated until it ran for at least min_time seconds; results go to stdout as csv, one line
+// per case and cloud:
+//
+//   case,cloud,points,ops,ns_per_op,points_per_s,allocs_per_op
+//
+// where points is the size of the cloud and points_per_s counts the points processed by an op (the
+// whole cloud for loadOBJ and makeTree, one query, vertex, sample or cell otherwise). Progress goes
+// to stderr.
+//
+// Clouds are normalized to the unit cube and the parameters scaled with their density (density_params
+// in bench_utils.h). The marching cubes case runs march_cell, the lattice version of vMarchCube which
+// needs a GL context. rimls_kernel times the version of rimls_step specialized for the parameters on
+// the same neighborhoods as rimls_step.
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <string>
+
+#include "data.h"
+#include "rimls.h"
+#include "bench_utils.h"
+#include "lattice.h"
+#include "extract.h"
+#include "synthetic.h"
+#include "stats.h"
+
+
+#ifdef C2S_MEMTRACK
+
+// the allocation tracking build already replaces operator new
+static size_t allocation_count(){
+    return stats_allocations();
+}
+
+#else
+
+// every allocation of the process goes through these
+static std::atomic<size_t> nb_allocations(0);
+
+static size_t allocation_count(){
+    return nb_allocations;
+}
+
+void* operator new(size_t size){
+    nb_allocations++;
+    void* p = malloc(size ? size : 1);
+    if(p == NULL)
+        throw std::bad_alloc();
+    return p;
+}
+
+void* operator new[](size_t size){
+    return operator new(size);
+}
+
+void operator delete(void* p) noexcept { free(p); }
+void operator delete[](void* p) noexcept { free(p); }
+
+#endif
+
+
+static double min_time = 0.5;
+static const char * filter = NULL;
+
+// run op(i) for i = 0, 1, ... in batches of growing size until min_time is reached,
+// so that reading the clock does not weigh on short ops
+template<typename Op>
+static void run_case(const char * name, const std::string& cloud, size_t nb_points, size_t points_per_op, Op op){
+
+    if(filter != NULL && strstr(name, filter) == NULL)
+        return;
+
+    fprintf(stderr, "%s on %s...\n", name, cloud.c_str());
+
+    size_t ops = 0;
+    size_t batch = 1;
+    size_t allocations = allocation_count();
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    double elapsed = 0.0;
+
+    while(elapsed < min_time){
+        for(size_t b=0; b<batch; b++)
+            op(ops++);
+        elapsed = seconds_since(start);
+        batch *= 2;
+    }
+
+    allocations = allocation_count() - allocations;
+
+    printf("%s,%s,%lu,%lu,%.1f,%.1f,%.2f\n", name, cloud.c_str(), (unsigned long)nb_points, (unsigned long)ops,
+        elapsed * 1e9 / double(ops), double(points_per_op) * double(ops) / elapsed, double(allocations) / double(ops));
+    fflush(stdout);
+}
+
+
+static const int nb_queries = 1024;
+
+static void bench_cloud(const std::string& name, const std::vector<Data>& V, const char * path){
+
+    RimlsParams params = density_params(V.size());
+
+    run_case("loadOBJ", name, V.size(), V.size(), [&](size_t){
+        std::vector<Data> loaded;
+        loadOBJ(path, loaded);
+    });
+
+    Cube init_cube(V);
+
+    run_case("makeTree", name, V.size(), V.size(), [&](size_t){
+        OctTree<Data>* OT = makeTree(V, init_cube);
+        delete OT;
+    });
+
+    OctTree<Data>* OT = makeTree(V, init_cube);
+
+    // queries off the cloud, as lattice vertices are
+    size_t stride = glm::max(size_t(1), V.size() / nb_queries);
+    std::vector<Data> queries;
+    for(size_t i=0; i<V.size() && queries.size()<nb_queries; i+=stride)
+        queries.push_back(Data(V[i].p() + float(0.5)*params.grid_step*glm::vec3(1.0, 1.0, 1.0), glm::vec3(0.0, 0.0, 0.0)));
+
+    std::vector<Data> neighbors;
+
+    run_case("find_neighbors_radius", name, V.size(), 1, [&](size_t i){
+        float r = params.radius;
+        int counter = 0;
+        neighbors.clear();
+        find_neighbors(OT, queries[i % queries.size()], r, neighbors, init_cube, false, counter);
+    });
+
+    run_case("find_neighbors_best", name, V.size(), 1, [&](size_t i){
+        float r = params.radius;
+        int counter = 0;
+        neighbors.clear();
+        find_neighbors(OT, queries[i % queries.size()], r, neighbors, init_cube, true, counter);
+    });
+
+    // neighborhoods selected by rimls_support, as rimls_vertex does, so that only the kernel is timed
+    std::vector<glm::vec3> centers;
+    std::vector<std::vector<Data> > neighborhoods;
+    std::vector<float> supports;
+    OctTreeIndex index(OT, init_cube);
+    for(std::vector<Data>::const_iterator it=queries.begin(); it!=queries.end(); it++){
+        std::vector<Data> N;
+        float h;
+        if(!rimls_support((*it).p(), index, params, N, h))
+            continue;
+        centers.push_back((*it).p());
+        neighborhoods.push_back(N);
+        supports.push_back(h);
+    }
+
+    if(!neighborhoods.empty()){
+        run_case("rimls_step", name, V.size(), 1, [&](size_t i){
+            size_t q = i % neighborhoods.size();
+            glm::vec3 grad_f;
+            rimls_step(centers[q], neighborhoods[q], supports[q], params.sigma_r, params.sigma_n, params.max_iter, grad_f);
+        });
+
+        RimlsKernel kernel = rimls_kernel(params.max_neighbors, params.max_iter);
+        run_case("rimls_kernel", name, V.size(), 1, [&](size_t i){
+            size_t q = i % neighborhoods.size();
+            glm::vec3 grad_f;
+            kernel(centers[q], neighborhoods[q].data(), int(neighborhoods[q].size()), supports[q], params.sigma_r,
+                params.sigma_n, params.max_iter, grad_f);
+        });
+    }
+
+    run_case("rimls_regular", name, V.size(), 1, [&](size_t i){
+        rimls_regular(V[(i * stride) % V.size()], OT, init_cube, params.radius, params.grid_step, params.sigma_r,
+            params.sigma_n, params.max_neighbors, params.max_iter, params.fallback, params.fallback_radius);
+    });
+
+    // field on the cells around the queries
+    Lattice L(init_cube.origin, params.grid_step);
+    std::vector<uint64_t> cells;
+    const int bound = lattice_key_bias - 1;
+    activate_cells(queries, L, 1, LatticeKey(-bound, -bound, -bound), LatticeKey(bound, bound, bound), cells);
+    ScalarField field;
+    rimls_lattice(cells, L, OT, init_cube, params, field);
+
+    EdgeVertex edges[12];
+    int triangles[15];
+
+    run_case("march_cell", name, V.size(), 1, [&](size_t i){
+        march_cell(L, cells[i % cells.size()], field, 0.0, edges, triangles);
+    });
+
+    delete OT;
+}
+
+
+int main(int argc, char **argv)
+{
+    const char * fandisk = "fandisk.obj";
+    std::string tmp = ".";
+    std::vector<size_t> sizes = {10000, 100000, 1000000};
+
+    for(int i=1; i<argc; i++){
+        bool has_value = i+1 < argc;
+
+        if(strcmp(argv[i], "--fandisk") == 0 && has_value)
+            fandisk = argv[++i];
+        else if(strcmp(argv[i], "--min_time") == 0 && has_value)
+            min_time = atof(argv[++i]);
+        else if(strcmp(argv[i], "--filter") == 0 && has_value)
+            filter = argv[++i];
+        else if(strcmp(argv[i], "--tmp") == 0 && has_value)
+            tmp = argv[++i];
+        else if(strcmp(argv[i], "--sizes") == 0 && has_value){
+            sizes.clear();
+            split_list(argv[++i], sizes);
+        }
+        else{
+            printf("usage: %s [--fandisk path] [--sizes n,n,...] [--min_time s] [--filter name] [--tmp dir]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    printf("case,cloud,points,ops,ns_per_op,points_per_s,allocs_per_op\n");
+
+    std::vector<Data> V;
+    if(loadOBJ(fandisk, V) && !V.empty()){
+        Cube bounding_cube(V);
+        for(std::vector<Data>::iterator it=V.begin(); it!=V.end(); it++)
+            *it = Data(((*it).p() - bounding_cube.origin) / bounding_cube.scale, (*it).n());
+        bench_cloud("fandisk", V, fandisk);
+    }
+    else
+        fprintf(stderr, "skipping fandisk\n");
+
+    const char * shapes[3] = {"sphere", "torus", "plane"};
+
+    for(std::vector<size_t>::const_iterator n=sizes.begin(); n!=sizes.end(); n++){
+        for(int s=0; s<3; s++){
+            V.clear();
+            if(s == 0)
+                sphere_cloud(*n, V);
+            else if(s == 1)
+                torus_cloud(*n, V);
+            else
+                noisy_plane_cloud(*n, 0.002, V);
+
+            std::string name = std::string(shapes[s]) + "_" + std::to_string(*n);
+            std::string path = tmp + "/bench_" + name + ".obj";
+            if(!saveOBJ(path.c_str(), V))
+                return 1;
+
+            bench_cloud(name, V, path.c_str());
+            remove(path.c_str());
+        }
+    }
+
+    return 0;
+}
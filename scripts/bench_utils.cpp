@@ -0,0 +1,46 @@
+#include <cmath>
+#include <cstdlib>
+
+#include "bench_utils.h"
+
+
+double seconds_since(const std::chrono::steady_clock::time_point& start){
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+void split_list(const char * list, std::vector<std::string>& items){
+    std::string s(list);
+    size_t start = 0;
+    while(start <= s.size()){
+        size_t end = s.find(',', start);
+        if(end == std::string::npos)
+            end = s.size();
+        if(end > start)
+            items.push_back(s.substr(start, end - start));
+        start = end + 1;
+    }
+}
+
+void split_list(const char * list, std::vector<double>& items){
+    std::vector<std::string> words;
+    split_list(list, words);
+    for(std::vector<std::string>::const_iterator it=words.begin(); it!=words.end(); it++)
+        items.push_back(atof(it->c_str()));
+}
+
+void split_list(const char * list, std::vector<size_t>& items){
+    std::vector<double> values;
+    split_list(list, values);
+    for(std::vector<double>::const_iterator it=values.begin(); it!=values.end(); it++)
+        items.push_back(size_t(*it));
+}
+
+RimlsParams density_params(size_t nb_points, double extent){
+    // points spread over a surface: their spacing goes with extent / sqrt(nb_points)
+    RimlsParams params;
+    float scale = float(std::sqrt(double(reference_points) / double(nb_points)) * extent);
+    params.radius *= scale;
+    params.grid_step *= scale;
+    params.fallback_radius *= scale;
+    return params;
+}
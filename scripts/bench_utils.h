@@ -0,0 +1,28 @@
+#pragma once
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "rimls.h"
+
+
+
+// Helpers shared by the benchmarks (and the timings of Cloud2Surface)
+
+// seconds elapsed since start
+double seconds_since(const std::chrono::steady_clock::time_point& start);
+
+// items of the comma separated list, appended to items; empty items are left out, numbers may be
+// written 1e6
+void split_list(const char * list, std::vector<std::string>& items);
+void split_list(const char * list, std::vector<double>& items);
+void split_list(const char * list, std::vector<size_t>& items);
+
+// points of fandisk, whose density in the unit cube the defaults of RimlsParams are tuned for
+const size_t reference_points = 27208;
+
+// the defaults of RimlsParams with the radius, grid step and fallback radius scaled with the density of
+// a scan of nb_points points over an object of size extent, so that queries see as many neighbors as on
+// fandisk and the work per point stays the same across sizes
+RimlsParams density_params(size_t nb_points, double extent = 1.0);
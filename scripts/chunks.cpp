@@ -0,0 +1,168 @@
+#include <algorithm>
+#include <cmath>
+#include <unordered_map>
+#include <utility>
+
+#include "chunks.h"
+#include "decimate.h"
+#include "parallel.h"
+#include "stats.h"
+
+
+static float mean_edge(const Mesh& mesh){
+    double sum = 0.0;
+    for(size_t t=0; t<mesh.triangles.size(); t+=3)
+        for(int c=0; c<3; c++)
+            sum += glm::length(mesh.vertices[mesh.triangles[t + c]] - mesh.vertices[mesh.triangles[t + (c + 1) % 3]]);
+    return mesh.triangles.empty() ? 0.0 : float(sum / double(mesh.triangles.size()));
+}
+
+void build_chunks(const Mesh& mesh, size_t triangles_per_chunk, int nb_levels, std::vector<Chunk>& chunks){
+
+    C2S_TIMER("chunks");
+
+    chunks.clear();
+    size_t n = mesh.nb_triangles();
+    if(n == 0)
+        return;
+
+    glm::vec3 lo = mesh.vertices[0], hi = mesh.vertices[0];
+    for(std::vector<glm::vec3>::const_iterator v=mesh.vertices.begin(); v!=mesh.vertices.end(); v++){
+        lo = glm::min(lo, *v);
+        hi = glm::max(hi, *v);
+    }
+
+    int g = std::max(1, int(std::ceil(std::cbrt(double(n) / double(triangles_per_chunk)))));
+    size_t nb_chunks = size_t(g) * g * g;
+
+    // chunk of each triangle, then triangles sorted by chunk
+    std::vector<unsigned int> chunk_of(n);
+    std::vector<size_t> offsets(nb_chunks + 1, 0);
+    for(size_t t=0; t<n; t++){
+        glm::vec3 centroid = (mesh.vertices[mesh.triangles[3*t]] + mesh.vertices[mesh.triangles[3*t+1]]
+            + mesh.vertices[mesh.triangles[3*t+2]]) / 3.0f;
+        int c[3];
+        for(int a=0; a<3; a++){
+            float s = (hi[a] > lo[a]) ? (centroid[a] - lo[a]) / (hi[a] - lo[a]) : 0.0f;
+            c[a] = std::max(0, std::min(g - 1, int(s * g)));
+        }
+        chunk_of[t] = (unsigned int)((c[2] * g + c[1]) * g + c[0]);
+        offsets[chunk_of[t] + 1]++;
+    }
+    for(size_t c=0; c<nb_chunks; c++)
+        offsets[c + 1] += offsets[c];
+
+    std::vector<size_t> order(n);
+    std::vector<size_t> next(offsets.begin(), offsets.end() - 1);
+    for(size_t t=0; t<n; t++)
+        order[next[chunk_of[t]]++] = t;
+
+    std::vector<Chunk> all(nb_chunks);
+
+    // chunks are decimated in parallel, each by one thread (decimate_mesh nested in parallel_for)
+    parallel_for(nb_chunks, [&](size_t begin, size_t end){
+        for(size_t c=begin; c<end; c++){
+            if(offsets[c] == offsets[c + 1])
+                continue;
+
+            Chunk& C = all[c];
+            C.levels.resize(1);
+            Mesh& M = C.levels[0].mesh;
+            std::unordered_map<unsigned int, unsigned int> local;    // vertex of mesh -> vertex of the chunk
+
+            for(size_t i=offsets[c]; i<offsets[c + 1]; i++){
+                for(int k=0; k<3; k++){
+                    unsigned int v = mesh.triangles[3*order[i] + k];
+                    std::unordered_map<unsigned int, unsigned int>::const_iterator found = local.find(v);
+                    if(found != local.end()){
+                        M.triangles.push_back(found->second);
+                        continue;
+                    }
+                    local[v] = (unsigned int)M.vertices.size();
+                    M.triangles.push_back((unsigned int)M.vertices.size());
+                    M.vertices.push_back(mesh.vertices[v]);
+                    M.normals.push_back(mesh.normals[v]);
+                }
+            }
+
+            C.lo = C.hi = M.vertices[0];
+            for(std::vector<glm::vec3>::const_iterator v=M.vertices.begin(); v!=M.vertices.end(); v++){
+                C.lo = glm::min(C.lo, *v);
+                C.hi = glm::max(C.hi, *v);
+            }
+
+            C.levels[0].nb_triangles = M.nb_triangles();
+            C.levels[0].edge = mean_edge(M);
+
+            for(int l=1; l<nb_levels; l++){
+                ChunkLevel level;
+                level.mesh = C.levels.back().mesh;
+                size_t before = level.mesh.nb_triangles();
+                decimate_mesh(level.mesh, before / 4, 0.0);
+                // a level barely coarser than the previous one (a chunk that is mostly border) is not worth it
+                if(level.mesh.nb_triangles() * 10 > before * 9)
+                    break;
+                level.nb_triangles = level.mesh.nb_triangles();
+                level.edge = mean_edge(level.mesh);
+                C.levels.push_back(std::move(level));
+            }
+        }
+    });
+
+    for(size_t c=0; c<nb_chunks; c++){
+        if(!all[c].levels.empty())
+            chunks.push_back(std::move(all[c]));
+    }
+}
+
+
+Frustum make_frustum(const float projection[16], const float modelview[16]){
+
+    // rows of projection * modelview, both column major
+    float M[4][4];
+    for(int r=0; r<4; r++)
+        for(int c=0; c<4; c++){
+            M[r][c] = 0.0;
+            for(int k=0; k<4; k++)
+                M[r][c] += projection[k*4 + r] * modelview[c*4 + k];
+        }
+
+    Frustum F;
+    for(int a=0; a<3; a++){
+        F.planes[2*a] = glm::vec4(M[3][0] + M[a][0], M[3][1] + M[a][1], M[3][2] + M[a][2], M[3][3] + M[a][3]);
+        F.planes[2*a + 1] = glm::vec4(M[3][0] - M[a][0], M[3][1] - M[a][1], M[3][2] - M[a][2], M[3][3] - M[a][3]);
+    }
+    return F;
+}
+
+bool intersects(const Frustum& F, const glm::vec3& lo, const glm::vec3& hi){
+    for(int p=0; p<6; p++){
+        const glm::vec4& P = F.planes[p];
+        // corner of the box furthest along the normal of the plane
+        glm::vec3 X(P.x >= 0.0 ? hi.x : lo.x, P.y >= 0.0 ? hi.y : lo.y, P.z >= 0.0 ? hi.z : lo.z);
+        if(P.x * X.x + P.y * X.y + P.z * X.z + P.w < 0.0)
+            return false;
+    }
+    return true;
+}
+
+float pixels_per_unit(const float projection[16], const float modelview[16], const glm::vec3& X, int height){
+
+    // scale of the modelview, taken as uniform, and depth term w of X in clip space
+    float scale = std::sqrt(modelview[0]*modelview[0] + modelview[1]*modelview[1] + modelview[2]*modelview[2]);
+    float eye[4];
+    for(int r=0; r<4; r++)
+        eye[r] = modelview[r] * X.x + modelview[4 + r] * X.y + modelview[8 + r] * X.z + modelview[12 + r];
+    float w = projection[3] * eye[0] + projection[7] * eye[1] + projection[11] * eye[2] + projection[15] * eye[3];
+    w = std::max(std::fabs(w), 1e-6f);
+
+    return 0.5f * float(height) * std::fabs(projection[5]) * scale / w;
+}
+
+int select_level(const Chunk& C, float scale, float max_pixels){
+    for(int l=int(C.levels.size())-1; l>0; l--){
+        if(C.levels[l].edge * scale <= max_pixels)
+            return l;
+    }
+    return 0;
+}
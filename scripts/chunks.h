@@ -0,0 +1,52 @@
+#pragma once
+
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "extract.h"
+
+
+
+// Spatial chunks of a mesh for the viewer (main.cpp): the mesh is cut along a regular grid into chunks of
+// about chunk_triangles triangles, a triangle going to the chunk of its centroid, each chunk with its own
+// vertex arrays and bounding box so that it is uploaded once, skipped when outside the view frustum and
+// drawn at a coarser level of detail when its triangles cover few pixels. Coarser levels are decimated
+// (decimate.h) from the previous one; the border of a chunk is left as is, so that neighboring chunks
+// drawn at different levels still meet without cracks
+
+const size_t chunk_triangles = 1 << 16;
+// level l keeps about 1 / 4^l of the triangles of the chunk
+const int chunk_levels = 4;
+
+struct ChunkLevel{
+    Mesh mesh;                 // vertex indices local to the chunk
+    size_t nb_triangles;       // kept once mesh is released (e.g. uploaded)
+    float edge;                // mean edge length
+};
+
+struct Chunk{
+    glm::vec3 lo, hi;                  // bounding box
+    std::vector<ChunkLevel> levels;    // finest first
+};
+
+// cut mesh into chunks of about triangles_per_chunk triangles with nb_levels levels each; chunks are
+// built on parallel_threads() threads, empty ones are left out
+void build_chunks(const Mesh& mesh, size_t triangles_per_chunk, int nb_levels, std::vector<Chunk>& chunks);
+
+
+// planes (a, b, c, d) of a view frustum, X being inside where a X.x + b X.y + c X.z + d >= 0 for all 6
+struct Frustum{
+    glm::vec4 planes[6];
+};
+
+// frustum of the column major OpenGL matrices projection and modelview (as from glGetFloatv)
+Frustum make_frustum(const float projection[16], const float modelview[16]);
+
+// false when the box [lo, hi] is entirely outside one of the planes of F
+bool intersects(const Frustum& F, const glm::vec3& lo, const glm::vec3& hi);
+
+// pixels covered on screen by a length of 1 at X, for a viewport of height pixels
+float pixels_per_unit(const float projection[16], const float modelview[16], const glm::vec3& X, int height);
+
+// coarsest level of C whose edges cover at most max_pixels pixels at scale pixels per unit
+int select_level(const Chunk& C, float scale, float max_pixels);
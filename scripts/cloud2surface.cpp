@@ -0,0 +1,449 @@
+// Command line reconstruction, without the viewer
+//
+// usage: Cloud2Surface cloud.obj [--out dir] [--budget MB] [--dilation cells] [--index dir] [--cache dir]
+//                                [--target value] [--coordinator spool] [--workers n] [--insert pass.obj]...
+//                                [--progressive levels] [--sweep sigma_r:sigma_n:max_iter,...] [--save_field]
+//                                [--format obj|ply|stl] [--pipeline depth] [--threads n] [--normals k]
+//                                [--downsample f] [--dedup epsilon] [--outliers sigma] [--outlier_k k]
+//                                [--radius r] [--step s] [--sigma_r s] [--sigma_n s] [--max_neighbors n]
+//                                [--max_iter n] [--fallback skip|knn] [--fallback_radius r] [--dual]
+//                                [--decimate ratio] [--max_error e] [--kdtree]
+//        Cloud2Surface --worker spool
+//
+// Lengths are given in the unit cube the cloud is normalized to. With a memory budget the
+// reconstruction runs out of core, brick by brick, writing one mesh piece per brick. With --index the
+// tree of each brick is saved to dir, and mapped back instead of rebuilt by later runs on the same points.
+// With --kdtree the points are indexed by a kd-tree instead of an OctTree, faster to search on scans of
+// uneven density or elongated shape (out of core and with --sweep; not with --index).
+// With --cache the evaluated field of each brick is saved to dir, and later runs on the same points with
+// the same parameters only extract the surface, e.g. at another --target iso-value (0 by default).
+// With --save_field the field of each brick is also written to out/brick_<i>_<j>_<k>.sfield, without the
+// gradients that --dual needs, so the two cannot be combined. With --format the mesh pieces are streamed
+// to their file in that format as they are extracted, instead of being extracted whole and saved as obj.
+// With --pipeline the bricks are loaded, indexed, evaluated and extracted on separate threads, each step
+// working on its own brick, with at most depth bricks waiting between two steps; the bricks are made
+// smaller so that all those held at once fit in the --budget (a budget too small for bricks of twice the
+// halo lowers the depth, down to one brick at a time), and the utilization of each step is printed at the
+// end. With --dual the surface is extracted by dual contouring instead of marching cubes, keeping the
+// sharp creases and corners of the cloud at a coarser --step (out of core, in the workers and with
+// --sweep). With --decimate each mesh piece is simplified down to that fraction of its triangles by
+// collapsing the edges that move it least, and with --max_error only as long as the surface moves by less
+// than e; the borders of the pieces are kept so that they still meet (out of core and with --sweep; with
+// --coordinator the welded mesh is simplified).
+// With --coordinator the bricks are posted as jobs to the spool directory and reconstructed
+// by n local worker processes (and/or workers started by hand on hosts sharing the spool),
+// the pieces are then welded into out/mesh.obj (or in the --format given).
+// With --insert the cloud is reconstructed in memory, then each scanner pass is inserted in turn
+// and only the part of the surface it touches is updated; the final surface goes to out/mesh.obj.
+// With --sweep the cloud is reconstructed in memory once per sigma_r:sigma_n:max_iter tuple, each surface
+// going to out/sweep_<n>.obj; the neighbors of each vertex are searched once and shared by all tuples.
+// With --progressive the surface is first extracted at a step 2^(levels-1) times coarser, then refined
+// around the previous surface; each level is written to out/level_<n>.obj as soon as it is done.
+// The implicit function is evaluated on --threads threads, all hardware threads by default.
+// A cloud without normals first gets normals estimated from its k nearest neighbors (16 by default).
+// With --dedup points closer than epsilon to a previous point are first merged into it, and with
+// --downsample the points are merged in voxels of f times the grid step. With --outliers, points whose
+// mean distance to their k nearest neighbors (8 by default) is more than sigma standard deviations above
+// the mean are removed, before downsampling. The preprocessed cloud is written to out/cloud.obj, which
+// is then reconstructed as any other cloud.
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+
+#include "data.h"
+#include "rimls.h"
+#include "tiling.h"
+#include "spool.h"
+#include "incremental.h"
+#include "progressive.h"
+#include "dual_contour.h"
+#include "kd_tree.h"
+#include "parallel.h"
+#include "normals.h"
+#include "preprocess.h"
+#include "bench_utils.h"
+
+
+// load path, normalized with the bounding cube of the first cloud
+static bool load_normalized(const char * path, const Cube& bounding_cube, std::vector<Data>& V){
+    if(!loadOBJ(path, V))
+        return false;
+    for(std::vector<Data>::iterator it=V.begin(); it!=V.end(); it++)
+        *it = normalize(*it, bounding_cube);
+    return true;
+}
+
+// first cloud, then each scanner pass inserted in turn; the tree covers twice the extent of the
+// first cloud so that later passes may reach beyond it
+static bool reconstruct_incremental(const char * path, const std::vector<const char*>& passes, const RimlsParams& params,
+    const TilingOptions& options){
+
+    std::vector<Data> cloud;
+    if(!loadOBJ(path, cloud) || cloud.empty())
+        return false;
+    Cube bounding_cube(cloud);
+    for(std::vector<Data>::iterator it=cloud.begin(); it!=cloud.end(); it++)
+        *it = normalize(*it, bounding_cube);
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    Reconstruction R(cloud, Cube(glm::vec3(-0.5, -0.5, -0.5), 2.0), params, options.dilation, options.target);
+    printf("%s: %lu points, %lu vertices evaluated, %lu cells extracted in %.3fs\n", path, (unsigned long)cloud.size(),
+        (unsigned long)R.nb_evaluated(), (unsigned long)R.changed().size(), seconds_since(start));
+
+    for(std::vector<const char*>::const_iterator it=passes.begin(); it!=passes.end(); it++){
+        std::vector<Data> pass;
+        if(!load_normalized(*it, bounding_cube, pass))
+            return false;
+
+        start = std::chrono::steady_clock::now();
+        size_t added = R.insert(pass);
+        printf("%s: %lu/%lu points inserted, %lu vertices evaluated, %lu cells extracted in %.3fs\n", *it,
+            (unsigned long)added, (unsigned long)pass.size(), (unsigned long)R.nb_evaluated(),
+            (unsigned long)R.changed().size(), seconds_since(start));
+    }
+
+    Mesh mesh;
+    R.mesh(mesh);
+    for(std::vector<glm::vec3>::iterator v=mesh.vertices.begin(); v!=mesh.vertices.end(); v++)
+        *v = bounding_cube.origin + (*v) * bounding_cube.scale;
+
+    if(!saveOBJ((options.out_dir + "/mesh.obj").c_str(), mesh))
+        return false;
+
+    printf("%lu triangles written to %s/mesh.obj\n", (unsigned long)mesh.nb_triangles(), options.out_dir.c_str());
+    return true;
+}
+
+
+// params with sigma_r, sigma_n and max_iter of each tuple of list (sigma_r:sigma_n:max_iter,...)
+static bool parse_sweep(const char * list, const RimlsParams& params, std::vector<RimlsParams>& sweep){
+    std::string s(list);
+    size_t start = 0;
+    while(start < s.size()){
+        size_t end = s.find(',', start);
+        if(end == std::string::npos)
+            end = s.size();
+        RimlsParams P(params);
+        if(sscanf(s.substr(start, end - start).c_str(), "%f:%f:%d", &P.sigma_r, &P.sigma_n, &P.max_iter) != 3){
+            printf("ERROR: bad sweep tuple %s\n", s.substr(start, end - start).c_str());
+            return false;
+        }
+        sweep.push_back(P);
+        start = end + 1;
+    }
+    return !sweep.empty();
+}
+
+static bool reconstruct_sweep(const char * path, const std::vector<RimlsParams>& sweep, const TilingOptions& options){
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    std::vector<Data> cloud;
+    if(!loadOBJ(path, cloud) || cloud.empty())
+        return false;
+    Cube bounding_cube(cloud);
+    for(std::vector<Data>::iterator it=cloud.begin(); it!=cloud.end(); it++)
+        *it = normalize(*it, bounding_cube);
+
+    Cube init_cube(cloud);
+    OctTree<Data>* OT = NULL;
+    KdTree* kd = NULL;
+    if(options.kd_tree)
+        kd = new KdTree(cloud, init_cube);
+    else
+        OT = makeTree(cloud, init_cube);
+
+    Lattice L(glm::vec3(0.0, 0.0, 0.0), sweep[0].grid_step);
+    std::vector<uint64_t> cells;
+    const int bound = lattice_key_bias - 1;
+    activate_cells(cloud, L, options.dilation, LatticeKey(-bound, -bound, -bound), LatticeKey(bound, bound, bound), cells);
+
+    std::vector<ScalarField> fields;
+    if(kd != NULL)
+        rimls_sweep(cells, L, *kd, sweep, fields);
+    else
+        rimls_sweep(cells, L, OctTreeIndex(OT, init_cube), sweep, fields);
+    delete OT;
+    delete kd;
+    printf("%lu fields of %lu vertices evaluated in %.3fs\n", (unsigned long)fields.size(), 
+        (unsigned long)fields[0].size(), seconds_since(start));
+
+    for(size_t t=0; t<sweep.size(); t++){
+        Mesh mesh;
+        if(options.dual_contouring)
+            dual_contour(L, cells, fields[t], options.target, mesh);
+        else
+            extract_mesh(L, cells, fields[t], options.target, mesh);
+        decimate_piece(mesh, options);
+        for(std::vector<glm::vec3>::iterator v=mesh.vertices.begin(); v!=mesh.vertices.end(); v++)
+            *v = bounding_cube.origin + (*v) * bounding_cube.scale;
+
+        char name[64];
+        sprintf(name, "/sweep_%lu.obj", (unsigned long)t);
+        if(!saveOBJ((options.out_dir + name).c_str(), mesh))
+            return false;
+        printf("sigma_r %g sigma_n %g max_iter %d: %lu triangles written to %s%s\n", sweep[t].sigma_r, sweep[t].sigma_n,
+            sweep[t].max_iter, (unsigned long)mesh.nb_triangles(), options.out_dir.c_str(), name);
+    }
+
+    return true;
+}
+
+
+static bool reconstruct_progressive(const char * path, int levels, const RimlsParams& params, const TilingOptions& options){
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    std::vector<Data> cloud;
+    if(!loadOBJ(path, cloud) || cloud.empty())
+        return false;
+    Cube bounding_cube(cloud);
+    for(std::vector<Data>::iterator it=cloud.begin(); it!=cloud.end(); it++)
+        *it = normalize(*it, bounding_cube);
+
+    Cube init_cube(cloud);
+    OctTree<Data>* OT = makeTree(cloud, init_cube);
+
+    bool ok = true;
+    rimls_progressive(cloud, OT, init_cube, params, levels, options.dilation, options.target,
+        [&](int level, const Lattice& L, const Mesh& mesh){
+            Mesh M(mesh);
+            for(std::vector<glm::vec3>::iterator v=M.vertices.begin(); v!=M.vertices.end(); v++)
+                *v = bounding_cube.origin + (*v) * bounding_cube.scale;
+
+            char name[64];
+            sprintf(name, "/level_%d.obj", level);
+            ok = saveOBJ((options.out_dir + name).c_str(), M) && ok;
+            printf("level %d (step %g): %lu triangles after %.3fs\n", level, L.step, (unsigned long)M.nb_triangles(),
+                seconds_since(start));
+            fflush(stdout);
+        });
+
+    delete OT;
+    return ok;
+}
+
+
+// merge points closer than epsilon, remove outliers beyond sigma (from k_outliers neighbors, sigma 0 to skip)
+// and downsample the cloud at path in voxels of size voxel (epsilon and voxel in the unit cube, 0 to skip),
+// estimate its normals if it has none (from k neighbors) and write it to processed
+static bool preprocess_cloud(const char * path, float epsilon, float sigma, int k_outliers, float voxel, int k,
+    const std::string& processed){
+
+    std::vector<Data> cloud;
+    bool has_normals;
+    if(!loadOBJ(path, cloud, has_normals) || cloud.empty())
+        return false;
+
+    if(epsilon > 0.0){
+        OctTree<Data>* OT = makeTree(cloud, Cube(cloud));
+        int depth = treeDepth(OT);
+        delete OT;
+
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        size_t merged = merge_duplicates(cloud, epsilon * Cube(cloud).scale);
+        double seconds = seconds_since(start);
+
+        OT = makeTree(cloud, Cube(cloud));
+        printf("%s: %lu points merged in %.3fs, tree depth %d before, %d after\n", path, (unsigned long)merged, seconds,
+            depth, treeDepth(OT));
+        delete OT;
+    }
+
+    if(sigma > 0.0){
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        size_t before = cloud.size();
+        size_t removed = remove_outliers(cloud, k_outliers, sigma);
+        printf("%s: %lu outliers removed out of %lu points in %.3fs\n", path, (unsigned long)removed,
+            (unsigned long)before, seconds_since(start));
+    }
+
+    if(voxel > 0.0){
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        size_t before = cloud.size();
+        if(!voxel_downsample(cloud, voxel * Cube(cloud).scale))
+            return false;
+        printf("%s: downsampled from %lu to %lu points (ratio %.2f) in %.3fs\n", path, (unsigned long)before,
+            (unsigned long)cloud.size(), double(before) / double(cloud.size()), seconds_since(start));
+    }
+
+    if(!has_normals){
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        estimate_normals(cloud, k);
+        printf("%s: normals of %lu points estimated in %.3fs\n", path, (unsigned long)cloud.size(), seconds_since(start));
+    }
+
+    if(!saveOBJ(processed.c_str(), cloud))
+        return false;
+
+    printf("preprocessed cloud written to %s\n", processed.c_str());
+    return true;
+}
+
+
+int main(int argc, char **argv)
+{
+    if(argc < 2){
+        printf("usage: %s cloud.obj [--out dir] [--budget MB] [--dilation cells] [--index dir] [--cache dir]\n", argv[0]);
+        printf("       [--target value] [--coordinator spool] [--workers n] [--insert pass.obj]...\n");
+        printf("       [--progressive levels] [--sweep sigma_r:sigma_n:max_iter,...] [--save_field]\n");
+        printf("       [--format obj|ply|stl] [--pipeline depth] [--threads n] [--normals k]\n");
+        printf("       [--downsample f] [--dedup epsilon] [--outliers sigma] [--outlier_k k]\n");
+        printf("       [--radius r] [--step s] [--sigma_r s] [--sigma_n s] [--max_neighbors n]\n");
+        printf("       [--max_iter n] [--fallback skip|knn] [--fallback_radius r] [--dual]\n");
+        printf("       [--decimate ratio] [--max_error e] [--kdtree]\n");
+        printf("       %s --worker spool\n", argv[0]);
+        return 1;
+    }
+
+    if(strcmp(argv[1], "--worker") == 0){
+        if(argc < 3){
+            printf("ERROR: --worker needs a spool directory\n");
+            return 1;
+        }
+        return run_worker(argv[2]) ? 0 : 1;
+    }
+
+    RimlsParams params;
+    TilingOptions options;
+    const char * spool = NULL;
+    int nb_workers = 1;
+    std::vector<const char*> passes;
+    int levels = 0;
+    const char * sweep_list = NULL;
+    int k = 16;
+    float downsample = 0.0;
+    float epsilon = 0.0;
+    float sigma = 0.0;
+    int k_outliers = 8;
+
+    for(int i=2; i<argc; i++){
+        bool has_value = i+1 < argc;
+
+        if(strcmp(argv[i], "--out") == 0 && has_value)
+            options.out_dir = argv[++i];
+        else if(strcmp(argv[i], "--budget") == 0 && has_value)
+            options.memory_budget = size_t(atof(argv[++i]) * 1024 * 1024);
+        else if(strcmp(argv[i], "--index") == 0 && has_value)
+            options.index_dir = argv[++i];
+        else if(strcmp(argv[i], "--kdtree") == 0)
+            options.kd_tree = true;
+        else if(strcmp(argv[i], "--cache") == 0 && has_value)
+            options.cache_dir = argv[++i];
+        else if(strcmp(argv[i], "--format") == 0 && has_value){
+            options.mesh_format = argv[++i];
+            if(options.mesh_format != "obj" && options.mesh_format != "ply" && options.mesh_format != "stl"){
+                printf("ERROR: unknown mesh format %s\n", argv[i]);
+                return 1;
+            }
+        }
+        else if(strcmp(argv[i], "--pipeline") == 0 && has_value)
+            options.pipeline_depth = atoi(argv[++i]);
+        else if(strcmp(argv[i], "--dual") == 0)
+            options.dual_contouring = true;
+        else if(strcmp(argv[i], "--decimate") == 0 && has_value)
+            options.decimate_ratio = atof(argv[++i]);
+        else if(strcmp(argv[i], "--max_error") == 0 && has_value)
+            options.max_error = atof(argv[++i]);
+        else if(strcmp(argv[i], "--save_field") == 0)
+            options.save_field = true;
+        else if(strcmp(argv[i], "--target") == 0 && has_value)
+            options.target = atof(argv[++i]);
+        else if(strcmp(argv[i], "--coordinator") == 0 && has_value)
+            spool = argv[++i];
+        else if(strcmp(argv[i], "--workers") == 0 && has_value)
+            nb_workers = atoi(argv[++i]);
+        else if(strcmp(argv[i], "--insert") == 0 && has_value)
+            passes.push_back(argv[++i]);
+        else if(strcmp(argv[i], "--sweep") == 0 && has_value)
+            sweep_list = argv[++i];
+        else if(strcmp(argv[i], "--progressive") == 0 && has_value)
+            levels = atoi(argv[++i]);
+        else if(strcmp(argv[i], "--outliers") == 0 && has_value)
+            sigma = atof(argv[++i]);
+        else if(strcmp(argv[i], "--outlier_k") == 0 && has_value)
+            k_outliers = atoi(argv[++i]);
+        else if(strcmp(argv[i], "--dedup") == 0 && has_value)
+            epsilon = atof(argv[++i]);
+        else if(strcmp(argv[i], "--downsample") == 0 && has_value)
+            downsample = atof(argv[++i]);
+        else if(strcmp(argv[i], "--normals") == 0 && has_value)
+            k = atoi(argv[++i]);
+        else if(strcmp(argv[i], "--threads") == 0 && has_value)
+            set_parallel_threads(atoi(argv[++i]));
+        else if(strcmp(argv[i], "--dilation") == 0 && has_value)
+            options.dilation = atoi(argv[++i]);
+        else if(strcmp(argv[i], "--radius") == 0 && has_value)
+            params.radius = atof(argv[++i]);
+        else if(strcmp(argv[i], "--step") == 0 && has_value)
+            params.grid_step = atof(argv[++i]);
+        else if(strcmp(argv[i], "--sigma_r") == 0 && has_value)
+            params.sigma_r = atof(argv[++i]);
+        else if(strcmp(argv[i], "--sigma_n") == 0 && has_value)
+            params.sigma_n = atof(argv[++i]);
+        else if(strcmp(argv[i], "--max_neighbors") == 0 && has_value)
+            params.max_neighbors = atoi(argv[++i]);
+        else if(strcmp(argv[i], "--max_iter") == 0 && has_value)
+            params.max_iter = atoi(argv[++i]);
+        else if(strcmp(argv[i], "--fallback") == 0 && has_value){
+            i++;
+            if(strcmp(argv[i], "skip") == 0)
+                params.fallback = FALLBACK_SKIP;
+            else if(strcmp(argv[i], "knn") == 0)
+                params.fallback = FALLBACK_KNN;
+            else{
+                printf("ERROR: unknown fallback %s\n", argv[i]);
+                return 1;
+            }
+        }
+        else if(strcmp(argv[i], "--fallback_radius") == 0 && has_value)
+            params.fallback_radius = atof(argv[++i]);
+        else{
+            printf("ERROR: unknown option %s\n", argv[i]);
+            return 1;
+        }
+    }
+
+    if(options.kd_tree && !options.index_dir.empty()){
+        printf("ERROR: --kdtree and --index cannot be combined\n");
+        return 1;
+    }
+
+    if(options.save_field && options.dual_contouring){
+        printf("ERROR: --save_field and --dual cannot be combined, sparse field files hold no gradients\n");
+        return 1;
+    }
+
+    std::string input = argv[1];
+    if(epsilon > 0.0 || sigma > 0.0 || downsample > 0.0 || !hasNormalsOBJ(argv[1])){
+        input = options.out_dir + "/cloud.obj";
+        if(!preprocess_cloud(argv[1], epsilon, sigma, k_outliers, downsample * params.grid_step, k, input))
+            return 1;
+    }
+
+    if(sweep_list != NULL){
+        std::vector<RimlsParams> sweep;
+        if(!parse_sweep(sweep_list, params, sweep))
+            return 1;
+        return reconstruct_sweep(input.c_str(), sweep, options) ? 0 : 1;
+    }
+
+    if(levels > 0)
+        return reconstruct_progressive(input.c_str(), levels, params, options) ? 0 : 1;
+
+    if(!passes.empty())
+        return reconstruct_incremental(input.c_str(), passes, params, options) ? 0 : 1;
+
+    if(spool != NULL){
+        // workers are copies of this executable
+        if(!run_coordinator(input.c_str(), params, options, spool, nb_workers, "/proc/self/exe"))
+            return 1;
+        return 0;
+    }
+
+    if(!reconstruct_tiled(input.c_str(), params, options))
+        return 1;
+
+    return 0;
+}
@@ -1,4 +1,7 @@
+#include <algorithm>
+
 #include "data.h"
+#include "stats.h"
 
 
 bool loadOBJ(
@@ -6,6 +9,19 @@ bool loadOBJ(
     std::vector <Data> & point_cloud
     ){
 
+    bool has_normals;
+    return loadOBJ(path, point_cloud, has_normals);
+}
+
+
+bool loadOBJ(
+    const char * path,
+    std::vector <Data> & point_cloud,
+    bool & has_normals
+    ){
+
+    C2S_TIMER("load");
+
 	FILE * file = fopen(path, "r");
 	if( file == NULL ){
     	printf("Impossible to open the file !\n");
@@ -41,57 +57,129 @@ bool loadOBJ(
 	
 	}
 
-    if (out_vertices.size() != out_normals.size()){
+    fclose(file);
+
+    has_normals = !out_normals.empty();
+
+    if (has_normals && out_vertices.size() != out_normals.size()){
         printf("ERROR: .obj file should have as many normals as vertices\n");
+        return false;
     }
 
-    for(int i=0; i<out_vertices.size(); i++){
-            point_cloud.push_back(Data(out_vertices[i], out_normals[i]));
+    for(size_t i=0; i<out_vertices.size(); i++){
+            point_cloud.push_back(Data(out_vertices[i], has_normals ? out_normals[i] : glm::vec3(0.0, 0.0, 0.0)));
         }
-	
+
+    return true;
 };
 
 
-float scalar_product(glm::vec3 X, glm::vec3 Y){
-    return X.x*Y.x + X.y*Y.y + X.z*Y.z;
+bool hasNormalsOBJ(const char * path){
+
+    FILE * file = fopen(path, "r");
+    if( file == NULL )
+        return false;
+
+    char line[256];
+    bool found = false;
+    while(!found && fgets(line, sizeof(line), file) != NULL)
+        found = (strncmp(line, "vn ", 3) == 0);
+
+    fclose(file);
+    return found;
 }
 
-float euclidean_norm(glm::vec3 X){
-    return sqrt(scalar_product(X, X));
-};
 
-float euclidean_distance(glm::vec3 X, glm::vec3 Y){
-    return euclidean_norm(X-Y);
+bool saveOBJ(
+    const char * path,
+    const std::vector <Data> & point_cloud
+    ){
+
+    FILE * file = fopen(path, "w");
+    if( file == NULL ){
+        printf("Impossible to open the file !\n");
+        return false;
+    }
+
+    for(std::vector<Data>::const_iterator it=point_cloud.begin(); it!=point_cloud.end(); it++){
+        fprintf(file, "vn %f %f %f\n", (*it).n().x, (*it).n().y, (*it).n().z);
+        fprintf(file, "v %f %f %f\n", (*it).p().x, (*it).p().y, (*it).p().z);
+    }
+
+    fclose(file);
+    return true;
 }
 
 
-Data::Data(glm::vec3 X, glm::vec3 N){
-    point = X;
-    normal = N;
+ObjReader::ObjReader(const char * path){
+    file = fopen(path, "r");
+    if( file == NULL )
+        printf("Impossible to open the file !\n");
 }
 
-Data::Data(const Data& D){
-    point = D.point;
-    normal = D.normal;
+ObjReader::~ObjReader(){
+    if( file != NULL )
+        fclose(file);
 }
 
-Cube::Cube(glm::vec3 X, float s){
+bool ObjReader::next(Data& D){
+
+    while(vertices.empty() || normals.empty()){
+
+        char lineHeader[128];
+
+        if( file == NULL || fscanf(file, "%127s", lineHeader) == EOF ){
+            if(!vertices.empty() || !normals.empty())
+                printf("ERROR: .obj file should have as many normals as vertices\n");
+            return false;
+        }
+
+        if ( strcmp( lineHeader, "v" ) == 0 ){
+            glm::vec3 vertex;
+            fscanf(file, "%f %f %f\n", &vertex.x, &vertex.y, &vertex.z );
+            vertices.push_back(vertex);
+        }
+
+        else if ( strcmp( lineHeader, "vn" ) == 0 ){
+            glm::vec3 normal;
+            fscanf(file, "%f %f %f\n", &normal.x, &normal.y, &normal.z );
+            normals.push_back(normal);
+        }
+    }
+
+    D = Data(vertices.front(), normals.front());
+    vertices.pop_front();
+    normals.pop_front();
+    return true;
+}
+
+void ObjReader::rewind(){
+    if( file != NULL )
+        ::rewind(file);
+    vertices.clear();
+    normals.clear();
+}
+
+
+template<typename S>
+BasicCube<S>::BasicCube(Vec X, S s){
     origin = X;
     scale = s;
 
-    std::vector<float> temp (8, 0.0);
+    std::vector<S> temp (8, 0.0);
     scalar_field = temp;
 }
 
-Cube::Cube(const std::vector<Data>& v){
-    glm::vec2 bound_x(v[0].p()[0], v[0].p()[0]);
-    glm::vec2 bound_y(v[0].p()[1], v[0].p()[1]);
-    glm::vec2 bound_z(v[0].p()[2], v[0].p()[2]);
+template<typename S>
+BasicCube<S>::BasicCube(const std::vector<BasicData<S> >& v){
+    glm::tvec2<S> bound_x(v[0].p()[0], v[0].p()[0]);
+    glm::tvec2<S> bound_y(v[0].p()[1], v[0].p()[1]);
+    glm::tvec2<S> bound_z(v[0].p()[2], v[0].p()[2]);
 
-    for(std::vector<Data>::const_iterator it=v.begin(); it!=v.end(); it++){
-        float x = (*it).p()[0];
-        float y = (*it).p()[1];
-        float z = (*it).p()[2];
+    for(typename std::vector<BasicData<S> >::const_iterator it=v.begin(); it!=v.end(); it++){
+        S x = (*it).p()[0];
+        S y = (*it).p()[1];
+        S z = (*it).p()[2];
 
         if(x < bound_x[0])
             bound_x[0] = x;
@@ -109,43 +197,41 @@ Cube::Cube(const std::vector<Data>& v){
             bound_z[1] = z;
     }
 
-    float len_x = bound_x.y - bound_x.x;
-    float len_y = bound_y.y - bound_y.x;
-    float len_z = bound_z.y - bound_z.x;
+    S len_x = bound_x.y - bound_x.x;
+    S len_y = bound_y.y - bound_y.x;
+    S len_z = bound_z.y - bound_z.x;
 
     scale = glm::max(len_z, glm::max(len_y, len_x));
 
-    float center_x = (bound_x.x + bound_x.y) / 2.0;
-    float center_y = (bound_y.x + bound_y.y) / 2.0;
-    float center_z = (bound_z.x + bound_z.y) / 2.0;
+    S center_x = (bound_x.x + bound_x.y) / 2.0;
+    S center_y = (bound_y.x + bound_y.y) / 2.0;
+    S center_z = (bound_z.x + bound_z.y) / 2.0;
 
-    float origin_x = center_x - (scale / 2.0);
-    float origin_y = center_y - (scale / 2.0);
-    float origin_z = center_z - (scale / 2.0);
+    S origin_x = center_x - (scale / 2.0);
+    S origin_y = center_y - (scale / 2.0);
+    S origin_z = center_z - (scale / 2.0);
 
-    origin = glm::vec3(origin_x, origin_y, origin_z);
+    origin = Vec(origin_x, origin_y, origin_z);
 
-    std::vector<float> temp (8, 0.0);
+    std::vector<S> temp (8, 0.0);
     scalar_field = temp;
 }
 
-Cube::Cube(const Cube& C){
+template<typename S>
+BasicCube<S>::BasicCube(const BasicCube& C){
     origin = C.origin;
     scale = C.scale;
     scalar_field = C.scalar_field;
 }
 
-int Cube::subcube(glm::vec3 X) const{
-    float lx = X.x - origin.x;
-    float ly = X.y - origin.y;
-    float lz = X.z - origin.z;
+template<typename S>
+int BasicCube<S>::subcube(Vec X) const{
+    S lx = X.x - origin.x;
+    S ly = X.y - origin.y;
+    S lz = X.z - origin.z;
 
-    if(lx > scale || ly > scale || lz > scale || lx < 0.0 || ly < 0.0 || lz < 0.0){
-        printf("ERROR: X is not in cube\n");
-        return false;
-    }
-
-    float middle = scale / 2.0;
+    // no bounds check: a point pushed just outside the cube by rounding goes to the nearest sub-cube
+    S middle = scale / 2.0;
 
     if(lx < middle && ly < middle && lz < middle)
         return 0;
@@ -178,33 +264,46 @@ int Cube::subcube(glm::vec3 X) const{
 
 }
 
-void Cube::next_cube(int X){
-    glm::vec3 direction = cube_vertices[X];
+template<typename S>
+bool BasicCube<S>::contains(const Vec& X) const{
+    S lx = X.x - origin.x;
+    S ly = X.y - origin.y;
+    S lz = X.z - origin.z;
+
+    return !(lx > scale || ly > scale || lz > scale || lx < 0.0 || ly < 0.0 || lz < 0.0);
+}
+
+template<typename S>
+void BasicCube<S>::next_cube(int X){
+    Vec direction(cube_vertices[X]);
 
     scale = scale / 2.0;
     origin += direction*scale;
 }
 
-void Cube::previous_cube(int X){
-    glm::vec3 direction = cube_vertices[X];
+template<typename S>
+void BasicCube<S>::previous_cube(int X){
+    Vec direction(cube_vertices[X]);
 
     origin -= direction*scale;
     scale = scale * 2.0;
 
 }
 
-void Cube::add_field(int vertex, float value){
+template<typename S>
+void BasicCube<S>::add_field(int vertex, S value){
     scalar_field[vertex] = value;
 }
 
-bool Cube::intersect_sphere(const glm::vec3& P, float r) const{
+template<typename S>
+bool BasicCube<S>::intersect_sphere(const Vec& P, S r) const{
 
-    glm::vec3 nx(P.x+r, P.y, P.z);
-    glm::vec3 sx(P.x-r, P.y, P.z);
-    glm::vec3 ny(P.x, P.y+r, P.z);
-    glm::vec3 sy(P.x, P.y-r, P.z);
-    glm::vec3 nz(P.x, P.y, P.z+r);
-    glm::vec3 sz(P.x, P.y, P.z-r); // north and south of sphere along axis
+    Vec nx(P.x+r, P.y, P.z);
+    Vec sx(P.x-r, P.y, P.z);
+    Vec ny(P.x, P.y+r, P.z);
+    Vec sy(P.x, P.y-r, P.z);
+    Vec nz(P.x, P.y, P.z+r);
+    Vec sz(P.x, P.y, P.z-r); // north and south of sphere along axis
 
     bool intersect_on_xy = false;
     bool intersect_on_xz = false;
@@ -223,60 +322,95 @@ bool Cube::intersect_sphere(const glm::vec3& P, float r) const{
 }
 
 
-OctNode<Data>* makeTree(const std::vector<Data>& V, Cube init_cube){
+template<typename S>
+bool insertTree(OctTree<BasicData<S> >* OT, const BasicData<S>& D, const BasicCube<S>& init_cube){
 
-    OctNode<Data>* OT = new OctNode<Data>(); // init: empty OctNode
-    OctTree<Data>* rot = OT; // pointing at running Octree
+    if(!init_cube.contains(D.p()))
+        return false;
 
-    Cube C;
-    Data* transitory;
+    OctTree<BasicData<S> >* rot = OT; // pointing at running Octree
 
-    for(std::vector<Data>::const_iterator it=V.begin(); it!=V.end(); it++){
-        C.origin = init_cube.origin; C.scale = init_cube.scale;
-        int X = C.subcube((*it).p());
+    BasicCube<S> C;
+    C.origin = init_cube.origin; C.scale = init_cube.scale;
+    int X = C.subcube(D.p());
 
-        while(true){                   // moving down the nodes
-            if(rot->son(X)==nullptr)
-                break;
-            if(rot->son(X)->isLeaf())   // can be tested once son(X) is not nullptr
-                break;
-            rot = rot->son(X);
-            C.next_cube(X);
-            X = C.subcube((*it).p());
-        }
+    while(true){                   // moving down the nodes
+        if(rot->son(X)==nullptr)
+            break;
+        if(rot->son(X)->isLeaf())   // can be tested once son(X) is not nullptr
+            break;
+        rot = rot->son(X);
+        C.next_cube(X);
+        X = C.subcube(D.p());
+    }
 
-        if(rot->son(X)==nullptr){
-            rot->son(X) = new OctLeaf<Data>(*it);
-            rot = OT;
-            continue;
-        } 
-
-        if((rot->son(X))->isLeaf()){
-            if(*it==(rot->son(X))->value()) // ignore point if already in tree
-                continue;
-            transitory = &(rot->son(X))->value(); // stock value in the Leaf before changing it into a Node
-            rot->son(X) = new OctNode<Data>(); // replace Leaf by Node
-            rot = rot->son(X); // move down
-            C.next_cube(X);
-            X = C.subcube((*it).p());
-            while(true){
-                if(X!=C.subcube((*transitory).p()))
-                    break;
-                rot->son(X) = new OctNode<Data>();
-                rot = rot->son(X);
-                C.next_cube(X);
-                X = C.subcube((*it).p());
-            }
-            rot->son(X) = new OctLeaf<Data>(*it);
-            rot->son(C.subcube((*transitory).p())) = new OctLeaf<Data>(*transitory);
-            rot = OT;
-        }
+    if(rot->son(X)==nullptr){
+        rot->son(X) = new OctLeaf<BasicData<S> >(D);
+        return true;
+    }
+
+    if(D.p()==(rot->son(X))->value().p()) // ignore point if its position is already in tree (two points at the
+        return false;                       // same position could never be separated by subdividing)
+
+    BasicData<S> transitory((rot->son(X))->value()); // stock value in the Leaf before changing it into a Node
+
+    BasicCube<S> split(C);         // points closer than the resolution of the coordinates are not separated by
+    split.next_cube(X);            // subdividing either, the new one is then ignored as for a same position
+    for(int depth=0; split.subcube(D.p())==split.subcube(transitory.p()); depth++){
+        if(depth >= max_tree_depth)
+            return false;
+        split.next_cube(split.subcube(D.p()));
+    }
+
+    delete rot->son(X);
+    rot->son(X) = new OctNode<BasicData<S> >(); // replace Leaf by Node
+    rot = rot->son(X); // move down
+    C.next_cube(X);
+    X = C.subcube(D.p());
+    while(true){
+        if(X!=C.subcube(transitory.p()))
+            break;
+        rot->son(X) = new OctNode<BasicData<S> >();
+        rot = rot->son(X);
+        C.next_cube(X);
+        X = C.subcube(D.p());
     }
+    rot->son(X) = new OctLeaf<BasicData<S> >(D);
+    rot->son(C.subcube(transitory.p())) = new OctLeaf<BasicData<S> >(transitory);
+    return true;
+}
+
+
+template<typename S>
+int treeDepth(OctTree<BasicData<S> >* OT){
+    if(OT->isLeaf())
+        return 0;
+    int depth = 0;
+    for(int i=0; i<8; i++){
+        if(OT->son(i)!=nullptr)
+            depth = glm::max(depth, treeDepth(OT->son(i)));
+    }
+    return depth + 1;
+}
+
+
+template<typename S>
+OctNode<BasicData<S> >* makeTree(const std::vector<BasicData<S> >& V, BasicCube<S> init_cube){
+
+    C2S_TIMER("tree");
+
+    OctNode<BasicData<S> >* OT = new OctNode<BasicData<S> >(); // init: empty OctNode
+
+    for(typename std::vector<BasicData<S> >::const_iterator it=V.begin(); it!=V.end(); it++)
+        insertTree(OT, *it, init_cube);
+
     return OT;
 }
 
 
-void find_neighbors(OctTree<Data>* O, const Data& D, float& r, std::vector<Data>& V, Cube C, const bool& best, int& counter){
+template<typename S>
+void find_neighbors(OctTree<BasicData<S> >* O, const BasicData<S>& D, S& r, std::vector<BasicData<S> >& V, BasicCube<S> C, 
+    const bool& best, int& counter){
 
     for(int i=0; i<8; i++){
         if(O->son(i)==nullptr)
@@ -302,4 +436,105 @@ void find_neighbors(OctTree<Data>* O, const Data& D, float& r, std::vector<Data>
             C.previous_cube(i);   // previous cube corresponding to the node whose children are being inspected in the loop
         }
     }
-}
\ No newline at end of file
+}
+
+// squared distance from X to the cube of given origin and scale, 0 inside
+template<typename S>
+static S cube_distance2(const glm::tvec3<S>& X, const glm::tvec3<S>& origin, S scale){
+    S d2 = 0.0;
+    for(int i=0; i<3; i++){
+        S d = glm::max(origin[i] - X[i], glm::max(S(0.0), X[i] - origin[i] - scale));
+        d2 += d*d;
+    }
+    return d2;
+}
+
+template<typename S>
+struct KnnCandidate{
+    typedef std::pair<S, BasicData<S> > type;    // squared distance, point
+};
+
+template<typename S>
+static bool farther(const typename KnnCandidate<S>::type& A, const typename KnnCandidate<S>::type& B){
+    return A.first < B.first;
+}
+
+// heap holds the best candidates so far, farthest on top
+template<typename S>
+static void knn_search(OctTree<BasicData<S> >* O, const glm::tvec3<S>& X, size_t k, const glm::tvec3<S>& origin, S scale,
+    std::vector<typename KnnCandidate<S>::type>& heap){
+
+    typedef typename KnnCandidate<S>::type Candidate;
+
+    S half = scale / 2.0;
+    std::pair<S, int> nodes[8];    // inner sons by distance of their cube
+    int nb_nodes = 0;
+
+    for(int i=0; i<8; i++){
+        if(O->son(i)==nullptr)
+            continue;
+        glm::tvec3<S> corner = origin + half*glm::tvec3<S>(cube_vertices[i]);
+        if(O->son(i)->isLeaf()){
+            glm::tvec3<S> d = O->son(i)->value().p() - X;
+            S d2 = scalar_product(d, d);
+            if(heap.size() < k){
+                heap.push_back(Candidate(d2, O->son(i)->value()));
+                std::push_heap(heap.begin(), heap.end(), farther<S>);
+            }
+            else if(d2 < heap.front().first){
+                std::pop_heap(heap.begin(), heap.end(), farther<S>);
+                heap.back() = Candidate(d2, O->son(i)->value());
+                std::push_heap(heap.begin(), heap.end(), farther<S>);
+            }
+        }
+        else
+            nodes[nb_nodes++] = std::pair<S, int>(cube_distance2(X, corner, half), i);
+    }
+
+    std::sort(nodes, nodes + nb_nodes);
+
+    for(int n=0; n<nb_nodes; n++){
+        if(heap.size() == k && nodes[n].first > heap.front().first)
+            break;
+        C2S_COUNT(NODES_VISITED, 1);
+        int i = nodes[n].second;
+        knn_search(O->son(i), X, k, origin + half*glm::tvec3<S>(cube_vertices[i]), half, heap);
+    }
+}
+
+template<typename S>
+void find_knn(OctTree<BasicData<S> >* OT, const glm::tvec3<S>& X, int k, std::vector<BasicData<S> >& V, 
+    const BasicCube<S>& init_cube){
+
+    C2S_COUNT(NEIGHBOR_QUERIES, 1);
+
+    V.clear();
+    if(k <= 0)
+        return;
+
+    std::vector<typename KnnCandidate<S>::type> heap;
+    heap.reserve(k);
+    knn_search(OT, X, size_t(k), init_cube.origin, init_cube.scale, heap);
+
+    std::sort_heap(heap.begin(), heap.end(), farther<S>);
+    for(typename std::vector<typename KnnCandidate<S>::type>::const_iterator it=heap.begin(); it!=heap.end(); it++)
+        V.push_back(it->second);
+
+    C2S_COUNT(NEIGHBORS_FOUND, V.size());
+}
+
+
+template class BasicCube<float>;
+template class BasicCube<double>;
+
+template OctNode<Data>* makeTree(const std::vector<Data>& V, Cube init_cube);
+template OctNode<DataD>* makeTree(const std::vector<DataD>& V, CubeD init_cube);
+template bool insertTree(OctTree<Data>* OT, const Data& D, const Cube& init_cube);
+template bool insertTree(OctTree<DataD>* OT, const DataD& D, const CubeD& init_cube);
+template int treeDepth(OctTree<Data>* OT);
+template int treeDepth(OctTree<DataD>* OT);
+template void find_neighbors(OctTree<Data>* O, const Data& D, float& r, std::vector<Data>& V, Cube C, const bool& best, int& counter);
+template void find_neighbors(OctTree<DataD>* O, const DataD& D, double& r, std::vector<DataD>& V, CubeD C, const bool& best, 
+    int& counter);
+template void find_knn(OctTree<Data>* OT, const glm::vec3& X, int k, std::vector<Data>& V, const Cube& init_cube);
+template void find_knn(OctTree<DataD>* OT, const glm::dvec3& X, int k, std::vector<DataD>& V, const CubeD& init_cube);
@@ -2,6 +2,8 @@
 
 #include <iostream>
 #include <vector>
+#include <deque>
+#include <cmath>
 #include <cstring>
 #include <glm/glm.hpp>
 #include "stdio.h"
@@ -10,41 +12,102 @@
 
 
 
-float scalar_product(glm::vec3 X, glm::vec3 Y);
-float euclidean_norm(glm::vec3 X);
-float euclidean_distance(glm::vec3 X, glm::vec3 Y);
+// vector operations, for glm::vec3 and glm::dvec3
+template<typename S>
+inline S scalar_product(glm::tvec3<S> X, glm::tvec3<S> Y){
+	return X.x*Y.x + X.y*Y.y + X.z*Y.z;
+}
 
+template<typename S>
+inline S euclidean_norm(glm::tvec3<S> X){
+	return std::sqrt(scalar_product(X, X));
+}
 
-// class to manage 3D points and normals
-class Data{
+template<typename S>
+inline S euclidean_distance(glm::tvec3<S> X, glm::tvec3<S> Y){
+	return euclidean_norm(X-Y);
+}
+
+
+// class to manage 3D points and normals, S is the scalar type of coordinates (float or double)
+template<typename S>
+class BasicData{
+
+public:
+
+	typedef S Scalar;
+	typedef glm::tvec3<S> Vec;
 
 protected:
 
-	glm::vec3 point;
-	glm::vec3 normal;
+	Vec point;
+	Vec normal;
 
 public:
 
-	Data(glm::vec3 X, glm::vec3 N);
-	Data(){}
-    Data(const Data& D);
-    
-    inline glm::vec3 p() const { return point; }
-    inline glm::vec3 n() const { return normal; }
+	BasicData(Vec X, Vec N) : point(X), normal(N) {}
+	BasicData(){}
+    BasicData(const BasicData& D) : point(D.point), normal(D.normal) {}
+    // conversion from another scalar type
+    template<typename T>
+    explicit BasicData(const BasicData<T>& D) : point(Vec(D.p())), normal(Vec(D.n())) {}
+
+    inline Vec p() const { return point; }
+    inline Vec n() const { return normal; }
     
-    bool operator==(const Data &D) const { return point==D.point && normal==D.normal; }
-    bool operator!=(const Data &D) const { return point!=D.point || normal!=D.normal; }
+    bool operator==(const BasicData &D) const { return point==D.point && normal==D.normal; }
+    bool operator!=(const BasicData &D) const { return point!=D.point || normal!=D.normal; }
    
-    float dist(const Data &D) const { return euclidean_distance(point, D.point); }
+    S dist(const BasicData &D) const { return euclidean_distance(point, D.point); }
 };
 
+typedef BasicData<float> Data;
+typedef BasicData<double> DataD;
+
 
-// function to load .obj file into a vector of Data
+// function to load .obj file into a vector of Data; a file without normals gives null normals
 bool loadOBJ(
     const char * path,
     std::vector <Data> & point_cloud
 );
 
+// same as above, telling whether the file had normals
+bool loadOBJ(
+    const char * path,
+    std::vector <Data> & point_cloud,
+    bool & has_normals
+);
+
+// return true if the .obj file at path has normals, reading it only up to the first one
+bool hasNormalsOBJ(const char * path);
+
+// function to save a vector of Data as a .obj file readable by loadOBJ
+bool saveOBJ(
+    const char * path,
+    const std::vector <Data> & point_cloud
+);
+
+
+// streaming .obj reader for clouds that do not fit in memory: the i-th vertex is paired with
+// the i-th normal, only the vertices and normals read ahead of their pair are buffered
+class ObjReader{
+
+    FILE * file;
+    std::deque<glm::vec3> vertices;
+    std::deque<glm::vec3> normals;
+
+public:
+
+    ObjReader(const char * path);
+    ~ObjReader();
+
+    bool is_open() const { return file != NULL; }
+    // read next point, return false at end of file
+    bool next(Data& D);
+    // restart from the beginning of the file
+    void rewind();
+};
+
 
 // class for unit cubes to map the 3D space
 // first define cube vertices wrt origine vertice
@@ -60,31 +123,62 @@ const std::vector<glm::vec3> cube_vertices = {
 };
 
 
-class Cube{
+template<typename S>
+class BasicCube{
 
 public:
 
-	glm::vec3 origin;
-	float scale;
-    std::vector<float> scalar_field;  // in case same cubes are used for space delimitation and marching cubes
+	typedef glm::tvec3<S> Vec;
+
+	Vec origin;
+	S scale;
+    std::vector<S> scalar_field;  // in case same cubes are used for space delimitation and marching cubes
 
-	Cube() {};
-    Cube(glm::vec3 X, float s);
-    Cube(const Cube& C);
-    Cube(const std::vector<Data>& v);
+	BasicCube() {};
+    BasicCube(Vec X, S s);
+    BasicCube(const BasicCube& C);
+    BasicCube(const std::vector<BasicData<S> >& v);
 
-    int subcube(glm::vec3 X) const;
+    int subcube(Vec X) const;    // X just outside the cube goes to the nearest sub-cube
+    bool contains(const Vec& X) const;
     void next_cube(int X);
     void previous_cube(int X);
-    void add_field(int vertex, float value);
+    void add_field(int vertex, S value);
     // Return true iff this cube intersects with sphere defined by point P and radius r
-    bool intersect_sphere(const glm::vec3& P, float r) const;
+    bool intersect_sphere(const Vec& P, S r) const;
 };
 
+typedef BasicCube<float> Cube;
+typedef BasicCube<double> CubeD;
+
+
+// the functions below are instantiated for float and double
+
+// levels below the root past which two points are considered at the same position, far below the
+// resolution of float and double coordinates
+const int max_tree_depth = 128;
 
 // function to load a vector of Data into an OctTree
-OctNode<Data>* makeTree(const std::vector<Data>& V, Cube init_cube);
+template<typename S>
+OctNode<BasicData<S> >* makeTree(const std::vector<BasicData<S> >& V, BasicCube<S> init_cube);
+
+// insert D into the OctTree built on init_cube, return false if D is outside init_cube or if a point at the
+// same position is already in the tree
+template<typename S>
+bool insertTree(OctTree<BasicData<S> >* OT, const BasicData<S>& D, const BasicCube<S>& init_cube);
+
+// number of inner nodes on the longest path from the root to a leaf
+template<typename S>
+int treeDepth(OctTree<BasicData<S> >* OT);
 
 
 // recursive OctTree search
-void find_neighbors(OctTree<Data>* O, const Data& D, float& r, std::vector<Data>& V, Cube C, const bool& best, int& counter);
\ No newline at end of file
+template<typename S>
+void find_neighbors(OctTree<BasicData<S> >* O, const BasicData<S>& D, S& r, std::vector<BasicData<S> >& V, BasicCube<S> C, 
+    const bool& best, int& counter);
+
+// the k points of the OctTree built on init_cube nearest to X (X itself if it is in the tree), nearest first;
+// fewer if the tree holds less than k points
+template<typename S>
+void find_knn(OctTree<BasicData<S> >* OT, const glm::tvec3<S>& X, int k, std::vector<BasicData<S> >& V, 
+    const BasicCube<S>& init_cube);
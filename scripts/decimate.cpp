@@ -0,0 +1,394 @@
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <limits>
+#include <queue>
+#include <vector>
+
+#include "decimate.h"
+#include "parallel.h"
+#include "stats.h"
+
+
+// sum of (n.X + d)^2 over planes (n, d): upper triangle of its symmetric 4x4 matrix, row by row
+//   0 xx  1 xy  2 xz  3 x
+//         4 yy  5 yz  6 y
+//               7 zz  8 z
+//                     9 1
+struct Quadric{
+    double q[10];
+
+    Quadric() { std::fill(q, q + 10, 0.0); }
+
+    Quadric(const glm::dvec3& n, double d){
+        double p[4] = {n.x, n.y, n.z, d};
+        int c = 0;
+        for(int r=0; r<4; r++)
+            for(int s=r; s<4; s++)
+                q[c++] = p[r] * p[s];
+    }
+
+    Quadric& operator+=(const Quadric& Q){
+        for(int c=0; c<10; c++)
+            q[c] += Q.q[c];
+        return *this;
+    }
+
+    double error(const glm::dvec3& X) const{
+        double x = X.x, y = X.y, z = X.z;
+        return q[0]*x*x + 2.0*q[1]*x*y + 2.0*q[2]*x*z + 2.0*q[3]*x + q[4]*y*y + 2.0*q[5]*y*z + 2.0*q[6]*y
+            + q[7]*z*z + 2.0*q[8]*z + q[9];
+    }
+
+    // point of least error, false when the quadric is nearly singular (planes of a flat region or a crease)
+    bool minimum(glm::dvec3& X) const{
+        double a = q[0], b = q[1], c = q[2], d = q[4], e = q[5], f = q[7];
+        double det = a*(d*f - e*e) - b*(b*f - c*e) + c*(b*e - c*d);
+        double trace = a + d + f;
+        if(std::fabs(det) <= 1e-6 * trace * trace * trace)
+            return false;
+        double u = -q[3], v = -q[6], w = -q[8];
+        X.x = (u*(d*f - e*e) - b*(v*f - e*w) + c*(v*e - d*w)) / det;
+        X.y = (a*(v*f - e*w) - u*(b*f - c*e) + c*(b*w - v*c)) / det;
+        X.z = (a*(d*w - v*e) - b*(b*w - v*c) + u*(b*e - c*d)) / det;
+        return true;
+    }
+};
+
+
+// candidate collapse of vertex u into vertex v, moved to position; stale once either vertex changed
+struct Collapse{
+    double cost;
+    unsigned int u, v;
+    unsigned int stamp_u, stamp_v;
+    glm::dvec3 position;
+
+    bool operator<(const Collapse& C) const { return cost > C.cost; }    // cheapest on top of the heap
+};
+
+
+class Decimation{
+
+    Mesh& mesh;
+    std::vector<glm::dvec3> positions;
+    std::vector<Quadric> quadrics;
+    std::vector<std::vector<unsigned int> > faces;    // triangles of each vertex
+    std::vector<char> alive;                          // of each triangle
+    std::vector<char> removed, border, locked;        // of each vertex
+    std::vector<unsigned int> stamps;
+    std::vector<int> regions;
+
+    unsigned int corner(size_t f, int c) const { return mesh.triangles[3*f + c]; }
+    bool has(size_t f, unsigned int v) const { return corner(f, 0) == v || corner(f, 1) == v || corner(f, 2) == v; }
+
+    // vertices sharing a triangle with v
+    void neighbors(unsigned int v, std::vector<unsigned int>& N) const{
+        N.clear();
+        for(std::vector<unsigned int>::const_iterator f=faces[v].begin(); f!=faces[v].end(); f++)
+            for(int c=0; c<3; c++)
+                if(corner(*f, c) != v && std::find(N.begin(), N.end(), corner(*f, c)) == N.end())
+                    N.push_back(corner(*f, c));
+    }
+
+    // normal (scaled by twice the area) of triangle f with vertex v moved to X
+    glm::dvec3 normal(size_t f, unsigned int v, const glm::dvec3& X) const{
+        glm::dvec3 P[3];
+        for(int c=0; c<3; c++)
+            P[c] = corner(f, c) == v ? X : positions[corner(f, c)];
+        return glm::cross(P[1] - P[0], P[2] - P[0]);
+    }
+
+    // the triangles of v not around the edge uv keep their orientation when v goes to X
+    bool keeps_orientation(unsigned int v, unsigned int u, const glm::dvec3& X) const{
+        for(std::vector<unsigned int>::const_iterator f=faces[v].begin(); f!=faces[v].end(); f++){
+            if(has(*f, u))
+                continue;
+            glm::dvec3 before = normal(*f, v, positions[v]);
+            glm::dvec3 after = normal(*f, v, X);
+            if(glm::dot(before, after) <= 1e-3 * glm::length(before) * glm::length(after) || glm::dot(after, after) == 0.0)
+                return false;
+        }
+        return true;
+    }
+
+    Collapse evaluate(unsigned int u, unsigned int v) const{
+        Collapse C;
+        C.u = u;
+        C.v = v;
+        C.stamp_u = stamps[u];
+        C.stamp_v = stamps[v];
+
+        Quadric Q = quadrics[u];
+        Q += quadrics[v];
+
+        if(locked[v])
+            C.position = positions[v];
+        else if(!Q.minimum(C.position)){
+            glm::dvec3 candidates[3] = {positions[u], positions[v], 0.5 * (positions[u] + positions[v])};
+            C.position = candidates[0];
+            for(int c=1; c<3; c++)
+                if(Q.error(candidates[c]) < Q.error(C.position))
+                    C.position = candidates[c];
+        }
+        C.cost = std::max(0.0, Q.error(C.position));
+        return C;
+    }
+
+    // candidate collapses of the edge uv inside region p: the vertex that moves must be free
+    void push(unsigned int u, unsigned int v, int p, std::priority_queue<Collapse>& heap) const{
+        if(removed[v] || regions[v] != p || (locked[u] && locked[v]))
+            return;
+        if(locked[u])
+            std::swap(u, v);
+        heap.push(evaluate(u, v));
+    }
+
+    // collapse u into v at position, return false if it would break the mesh
+    bool collapse(unsigned int u, unsigned int v, const glm::dvec3& position, int p, std::priority_queue<Collapse>& heap,
+        std::vector<unsigned int>& Nu, std::vector<unsigned int>& Nv){
+
+        // manifold edge whose ends share no other neighbor than the third vertices of its 2 triangles
+        size_t shared = 0;
+        for(std::vector<unsigned int>::const_iterator f=faces[u].begin(); f!=faces[u].end(); f++)
+            shared += has(*f, v);
+        if(shared != 2)
+            return false;
+        neighbors(u, Nu);
+        neighbors(v, Nv);
+        size_t common = 0;
+        for(std::vector<unsigned int>::const_iterator w=Nu.begin(); w!=Nu.end(); w++)
+            common += std::find(Nv.begin(), Nv.end(), *w) != Nv.end();
+        if(common != 2)
+            return false;
+
+        // an edge between two border vertices would be created by the pieces on both sides of the border
+        if(border[v]){
+            for(std::vector<unsigned int>::const_iterator w=Nu.begin(); w!=Nu.end(); w++)
+                if(border[*w] && std::find(Nv.begin(), Nv.end(), *w) == Nv.end() && *w != v)
+                    return false;
+        }
+
+        if(!keeps_orientation(u, v, position) || (!locked[v] && !keeps_orientation(v, u, position)))
+            return false;
+
+        for(std::vector<unsigned int>::const_iterator f=faces[u].begin(); f!=faces[u].end(); f++){
+            if(!has(*f, v)){
+                for(int c=0; c<3; c++)
+                    if(corner(*f, c) == u)
+                        mesh.triangles[3*(*f) + c] = v;
+                faces[v].push_back(*f);
+                continue;
+            }
+            // triangle around the edge, gone
+            alive[*f] = false;
+            for(int c=0; c<3; c++){
+                std::vector<unsigned int>& F = faces[corner(*f, c)];
+                if(corner(*f, c) != u)
+                    F.erase(std::find(F.begin(), F.end(), *f));
+            }
+        }
+
+        positions[v] = position;
+        quadrics[v] += quadrics[u];
+        glm::vec3 n = mesh.normals[u] + mesh.normals[v];
+        if(glm::dot(n, n) > 0.0)
+            mesh.normals[v] = glm::normalize(n);
+        removed[u] = true;
+        std::vector<unsigned int>().swap(faces[u]);
+        stamps[v]++;
+
+        neighbors(v, Nv);
+        for(std::vector<unsigned int>::const_iterator w=Nv.begin(); w!=Nv.end(); w++)
+            push(v, *w, p, heap);
+        return true;
+    }
+
+public:
+
+    explicit Decimation(Mesh& M) : mesh(M) {
+
+        size_t n = mesh.nb_vertices();
+        positions.resize(n);
+        quadrics.resize(n);
+        faces.resize(n);
+        alive.assign(mesh.nb_triangles(), 1);
+        removed.assign(n, 0);
+        border.assign(n, 0);
+        locked.assign(n, 0);
+        stamps.assign(n, 0);
+        regions.assign(n, 0);
+
+        for(size_t v=0; v<n; v++)
+            positions[v] = glm::dvec3(mesh.vertices[v]);
+
+        for(size_t f=0; f<mesh.nb_triangles(); f++){
+            glm::dvec3 N = normal(f, corner(f, 0), positions[corner(f, 0)]);
+            double area = glm::length(N);
+            Quadric Q;
+            if(area > 0.0)
+                Q = Quadric(N / area, -glm::dot(N / area, positions[corner(f, 0)]));
+            for(int c=0; c<3; c++){
+                quadrics[corner(f, c)] += Q;
+                faces[corner(f, c)].push_back((unsigned int)f);
+            }
+        }
+
+        // edges with other than 2 triangles
+        parallel_for(n, [&](size_t begin, size_t end){
+            std::vector<unsigned int> N;
+            for(size_t v=begin; v<end; v++){
+                neighbors((unsigned int)v, N);
+                for(std::vector<unsigned int>::const_iterator w=N.begin(); w!=N.end() && !border[v]; w++){
+                    size_t shared = 0;
+                    for(std::vector<unsigned int>::const_iterator f=faces[v].begin(); f!=faces[v].end(); f++)
+                        shared += has(*f, *w);
+                    border[v] = shared != 2;
+                }
+            }
+        });
+    }
+
+    size_t nb_triangles() const { return size_t(std::count(alive.begin(), alive.end(), 1)); }
+
+    // one round over a grid of g^3 partitions shifted by shift partitions, removing about to_remove triangles
+    // (all it can when 0) with collapses under max_error2; return the number of triangles removed
+    size_t round(int g, double shift, size_t to_remove, double max_error2){
+
+        size_t n = positions.size();
+        glm::dvec3 lo(std::numeric_limits<double>::max()), hi(-std::numeric_limits<double>::max());
+        for(size_t v=0; v<n; v++){
+            if(removed[v])
+                continue;
+            for(int a=0; a<3; a++){
+                lo[a] = std::min(lo[a], positions[v][a]);
+                hi[a] = std::max(hi[a], positions[v][a]);
+            }
+        }
+
+        int side = g + 1;    // cells per axis once shifted
+        std::vector<std::vector<unsigned int> > members(side * side * side);
+        for(size_t v=0; v<n; v++){
+            if(removed[v])
+                continue;
+            int r[3];
+            for(int a=0; a<3; a++){
+                double t = (hi[a] > lo[a]) ? (positions[v][a] - lo[a]) / (hi[a] - lo[a]) : 0.0;
+                r[a] = std::max(0, std::min(g, int(std::floor(t * g + shift))));
+            }
+            regions[v] = (r[2] * side + r[1]) * side + r[0];
+            members[regions[v]].push_back((unsigned int)v);
+        }
+
+        parallel_for(n, [&](size_t begin, size_t end){
+            for(size_t v=begin; v<end; v++){
+                locked[v] = border[v];
+                for(std::vector<unsigned int>::const_iterator f=faces[v].begin(); f!=faces[v].end() && !locked[v]; f++)
+                    for(int c=0; c<3; c++)
+                        locked[v] |= regions[corner(*f, c)] != regions[v];
+            }
+        });
+
+        // each partition removes its share of the triangles, counted by their first vertex
+        size_t total = 0;
+        std::vector<size_t> quotas(members.size(), 0);
+        for(size_t f=0; f<alive.size(); f++){
+            if(alive[f]){
+                quotas[regions[corner(f, 0)]]++;
+                total++;
+            }
+        }
+        for(size_t p=0; p<quotas.size(); p++)
+            quotas[p] = (to_remove == 0) ? total : size_t(double(quotas[p]) * double(to_remove) / double(total) + 0.5);
+
+        std::atomic<size_t> nb_removed(0);
+
+        parallel_for(members.size(), [&](size_t begin, size_t end){
+            std::vector<unsigned int> Nu, Nv;
+            for(size_t p=begin; p<end; p++){
+
+                std::priority_queue<Collapse> heap;
+                for(std::vector<unsigned int>::const_iterator u=members[p].begin(); u!=members[p].end(); u++){
+                    if(locked[*u])
+                        continue;
+                    neighbors(*u, Nu);
+                    for(std::vector<unsigned int>::const_iterator v=Nu.begin(); v!=Nu.end(); v++)
+                        if(*u < *v || locked[*v])
+                            push(*u, *v, int(p), heap);
+                }
+
+                size_t done = 0;
+                while(!heap.empty() && done < quotas[p]){
+                    Collapse C = heap.top();
+                    heap.pop();
+                    if(removed[C.u] || removed[C.v] || stamps[C.u] != C.stamp_u || stamps[C.v] != C.stamp_v)
+                        continue;
+                    if(C.cost > max_error2)
+                        break;
+                    if(collapse(C.u, C.v, C.position, int(p), heap, Nu, Nv))
+                        done += 2;
+                }
+                nb_removed += done;
+            }
+        });
+
+        return nb_removed;
+    }
+
+    // drop removed triangles and the vertices left without any
+    void compact(){
+
+        std::vector<unsigned int> remap(positions.size(), ~0u);
+        std::vector<unsigned int> triangles;
+        Mesh M;
+
+        for(size_t f=0; f<alive.size(); f++){
+            if(!alive[f])
+                continue;
+            for(int c=0; c<3; c++){
+                unsigned int v = corner(f, c);
+                if(remap[v] == ~0u){
+                    remap[v] = (unsigned int)M.vertices.size();
+                    M.vertices.push_back(glm::vec3(positions[v]));
+                    M.normals.push_back(mesh.normals[v]);
+                    if(!mesh.keys.empty())
+                        M.keys.push_back(mesh.keys[v]);
+                }
+                M.triangles.push_back(remap[v]);
+            }
+        }
+
+        mesh.vertices.swap(M.vertices);
+        mesh.normals.swap(M.normals);
+        mesh.keys.swap(M.keys);
+        mesh.triangles.swap(M.triangles);
+    }
+};
+
+
+size_t decimate_mesh(Mesh& mesh, size_t target_triangles, float max_error){
+
+    C2S_TIMER("decimate");
+
+    size_t before = mesh.nb_triangles();
+    if(before <= target_triangles)
+        return 0;
+
+    double max_error2 = (max_error > 0.0) ? double(max_error) * double(max_error) : std::numeric_limits<double>::max();
+    int g = std::max(1, int(std::round(std::cbrt(double(before) / double(decimate_partition_triangles)))));
+
+    Decimation D(mesh);
+    size_t left = before;
+
+    // the shifts alternate so that each border of a round falls inside a partition of the next
+    const double shifts[4] = {0.0, 0.5, 0.25, 0.75};
+
+    for(int r=0; r<4 && left > target_triangles; r++){
+        size_t done = D.round(g, shifts[r], target_triangles > 0 ? left - target_triangles : 0, max_error2);
+        left -= done;
+        if(done == 0)
+            break;
+    }
+
+    D.compact();
+    return before - mesh.nb_triangles();
+}
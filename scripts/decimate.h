@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstddef>
+
+#include "extract.h"
+
+
+
+// Quadric error metric simplification: edges are collapsed cheapest first, each vertex carrying the sum of
+// the squared distances to the planes of the triangles it was built from (a quadric), so that the flat
+// regions where the extractors leave many tiny coplanar triangles go first and creases last.
+//
+// The mesh is cut into a grid of partitions simplified in parallel. A vertex whose triangles reach into
+// another partition is locked for the round, so that no two partitions ever touch the same triangle;
+// further rounds shift the grid by a fraction of a partition to release the previous borders. Vertices on
+// the open border of the mesh (or on non manifold edges) never move, so that pieces simplified separately
+// still weld on their keys. The grid only depends on the mesh, the result not on the number of threads
+
+// triangles per partition
+const size_t decimate_partition_triangles = 1 << 14;
+
+// collapse edges of mesh until it has at most target_triangles triangles, or until every collapse left would
+// move the surface by more than max_error (0 for no bound) from the planes of the triangles it replaces.
+// Collapses that would flip a triangle or make the mesh non manifold are skipped. Vertices left keep their
+// key, a merged vertex gets the renormalized sum of the normals merged. Return the number of triangles
+// removed
+size_t decimate_mesh(Mesh& mesh, size_t target_triangles, float max_error);
@@ -0,0 +1,255 @@
+#include <algorithm>
+#include <cmath>
+#include <unordered_map>
+
+#include "dual_contour.h"
+#include "stats.h"
+
+
+// vertex K moved by d along axis
+static LatticeKey offset(const LatticeKey& K, int axis, int d){
+    LatticeKey M = K;
+    if(axis == 0) M.i += d;
+    else if(axis == 1) M.j += d;
+    else M.k += d;
+    return M;
+}
+
+// eigenvalues w and eigenvectors (columns of V) of the symmetric matrix A, by Jacobi rotations; A is
+// diagonalized in place
+template<typename S>
+static void symmetric_eigen(S A[3][3], S w[3], S V[3][3]){
+
+    for(int r=0; r<3; r++)
+        for(int c=0; c<3; c++)
+            V[r][c] = (r == c) ? 1.0 : 0.0;
+
+    const int pairs[3][2] = {{0, 1}, {0, 2}, {1, 2}};
+
+    for(int sweep=0; sweep<16; sweep++){
+        S off = A[0][1]*A[0][1] + A[0][2]*A[0][2] + A[1][2]*A[1][2];
+        S diagonal = A[0][0]*A[0][0] + A[1][1]*A[1][1] + A[2][2]*A[2][2];
+        if(off <= S(1e-12) * diagonal)
+            break;
+
+        for(int r=0; r<3; r++){
+            int p = pairs[r][0];
+            int q = pairs[r][1];
+            if(A[p][q] == 0.0)
+                continue;
+
+            // rotation in the (p, q) plane cancelling A[p][q]
+            S theta = (A[q][q] - A[p][p]) / (2.0 * A[p][q]);
+            S t = S(theta >= 0.0 ? 1.0 : -1.0) / (std::fabs(theta) + std::sqrt(theta*theta + 1));
+            S c = 1 / std::sqrt(t*t + 1);
+            S s = t * c;
+
+            for(int k=0; k<3; k++){
+                S a = A[k][p], b = A[k][q];
+                A[k][p] = c*a - s*b;
+                A[k][q] = s*a + c*b;
+            }
+            for(int k=0; k<3; k++){
+                S a = A[p][k], b = A[q][k];
+                A[p][k] = c*a - s*b;
+                A[q][k] = s*a + c*b;
+            }
+            for(int k=0; k<3; k++){
+                S a = V[k][p], b = V[k][q];
+                V[k][p] = c*a - s*b;
+                V[k][q] = s*a + c*b;
+            }
+        }
+    }
+
+    for(int i=0; i<3; i++)
+        w[i] = A[i][i];
+}
+
+
+template<typename S>
+bool cell_vertex(const BasicLattice<S>& L, uint64_t cell, const BasicScalarField<S>& field, typename BasicLattice<S>::Scalar target,
+    glm::vec3& position, glm::vec3& normal){
+
+    LatticeKey C = unpack_key(cell);
+
+    // corner v is at (v & 1, v>>1 & 1, v>>2 & 1) in the cell
+    S values[8];
+    glm::tvec3<S> gradients[8];
+
+    for(int v=0; v<8; v++){
+        LatticeKey K(C.i + (v & 1), C.j + ((v>>1) & 1), C.k + ((v>>2) & 1));
+        typename BasicScalarField<S>::const_iterator s = field.find(pack_key(K));
+        if(s == field.end() || std::isnan(s->second.value))
+            return false;
+        values[v] = s->second.value;
+        gradients[v] = s->second.gradient;
+    }
+
+    // crossings of the 12 edges, in cell units so that the QEF is equally conditioned at any step
+    glm::tvec3<S> points[12], normals[12];
+    glm::tvec3<S> mass(0.0, 0.0, 0.0), mean_normal(0.0, 0.0, 0.0);
+    int n = 0;
+
+    for(int axis=0; axis<3; axis++){
+        for(int a=0; a<8; a++){
+            if(a & (1<<axis))
+                continue;
+            int b = a | (1<<axis);
+            if((values[a] <= target) == (values[b] <= target))
+                continue;
+
+            S delta = values[b] - values[a];
+            S t = (delta == 0.0) ? 0.5 : (target - values[a]) / delta;
+
+            glm::tvec3<S> P(S(a & 1), S((a>>1) & 1), S((a>>2) & 1));
+            P[axis] = t;
+
+            glm::tvec3<S> N = gradients[a] + t * (gradients[b] - gradients[a]);
+            S norm = euclidean_norm(N);
+            if(norm > 0.0)
+                N = N / norm;
+
+            points[n] = P;
+            normals[n] = N;
+            mass += P;
+            mean_normal += N;
+            n++;
+        }
+    }
+
+    if(n == 0)
+        return false;
+    mass /= S(n);
+
+    // QEF sum_e (N_e.(X - P_e))^2, minimized by A (X - mass) = B
+    S A[3][3] = {{0.0, 0.0, 0.0}, {0.0, 0.0, 0.0}, {0.0, 0.0, 0.0}};
+    glm::tvec3<S> B(0.0, 0.0, 0.0);
+    for(int e=0; e<n; e++){
+        for(int r=0; r<3; r++)
+            for(int c=0; c<3; c++)
+                A[r][c] += normals[e][r] * normals[e][c];
+        B += normals[e] * glm::dot(normals[e], points[e] - mass);
+    }
+
+    // truncated pseudo-inverse
+    S w[3], V[3][3];
+    symmetric_eigen(A, w, V);
+    S largest = std::max(std::fabs(w[0]), std::max(std::fabs(w[1]), std::fabs(w[2])));
+
+    glm::tvec3<S> X = mass;
+    for(int i=0; i<3; i++){
+        if(std::fabs(w[i]) <= S(qef_threshold) * largest || w[i] == 0.0)
+            continue;
+        glm::tvec3<S> v(V[0][i], V[1][i], V[2][i]);
+        X += v * (glm::dot(v, B) / w[i]);
+    }
+
+    // a vertex outside its cell would fold the quads around it
+    for(int a=0; a<3; a++)
+        X[a] = std::min(S(1.0), std::max(S(0.0), X[a]));
+
+    position = glm::vec3(L.vertex(C) + X * L.step);
+
+    S norm = euclidean_norm(mean_normal);
+    normal = glm::vec3(norm > 0.0 ? mean_normal / norm : mean_normal);
+    return true;
+}
+
+template<typename S>
+void dual_contour(const BasicLattice<S>& L, const std::vector<uint64_t>& cells, const BasicScalarField<S>& field, typename BasicLattice<S>::Scalar target,
+    Mesh& mesh){
+
+    C2S_TIMER("dual contour");
+
+    // vertex of each cell seen so far, added to mesh (v >= 0) once a quad uses it
+    struct CellVertex{
+        bool valid;
+        int v;
+        glm::vec3 position, normal;
+    };
+    std::unordered_map<uint64_t, CellVertex> index;
+
+    auto vertex = [&](const LatticeKey& K) -> CellVertex& {
+        uint64_t cell = pack_key(K);
+        typename std::unordered_map<uint64_t, CellVertex>::iterator found = index.find(cell);
+        if(found != index.end())
+            return found->second;
+        CellVertex& V = index[cell];
+        V.v = -1;
+        V.valid = cell_vertex(L, cell, field, target, V.position, V.normal);
+        return V;
+    };
+
+    size_t nb_triangles = 0;
+
+    for(std::vector<uint64_t>::const_iterator it=cells.begin(); it!=cells.end(); it++){
+
+        LatticeKey C = unpack_key(*it);
+        typename BasicScalarField<S>::const_iterator origin = field.find(pack_key(C));
+        if(origin == field.end() || std::isnan(origin->second.value))
+            continue;
+        bool inside = origin->second.value <= target;
+
+        for(int axis=0; axis<3; axis++){
+            typename BasicScalarField<S>::const_iterator end = field.find(pack_key(offset(C, axis, 1)));
+            if(end == field.end() || std::isnan(end->second.value) || (end->second.value <= target) == inside)
+                continue;
+
+            // cells around the edge, counterclockwise seen from the end of the edge
+            int b = (axis + 1) % 3;
+            int c = (axis + 2) % 3;
+            LatticeKey around[4] = {offset(offset(C, b, -1), c, -1), offset(C, c, -1), C, offset(C, b, -1)};
+
+            CellVertex* quad[4];
+            bool complete = true;
+            for(int v=0; v<4 && complete; v++){
+                quad[v] = &vertex(around[v]);
+                complete = quad[v]->valid;
+            }
+            if(!complete)
+                continue;
+
+            int q[4];
+            for(int v=0; v<4; v++){
+                CellVertex& V = *quad[v];
+                if(V.v < 0){
+                    V.v = int(mesh.vertices.size());
+                    mesh.vertices.push_back(V.position);
+                    mesh.normals.push_back(V.normal);
+                    mesh.keys.push_back(dual_vertex_key(pack_key(around[v])));
+                }
+                q[v] = V.v;
+            }
+
+            // wound as marching cubes triangles: clockwise seen from the side the normals point to
+            if(inside)
+                std::swap(q[1], q[3]);
+
+            // split along the shorter diagonal
+            if(euclidean_distance(mesh.vertices[q[0]], mesh.vertices[q[2]]) <= euclidean_distance(mesh.vertices[q[1]], mesh.vertices[q[3]])){
+                unsigned int t[6] = {(unsigned int)q[0], (unsigned int)q[1], (unsigned int)q[2],
+                    (unsigned int)q[0], (unsigned int)q[2], (unsigned int)q[3]};
+                mesh.triangles.insert(mesh.triangles.end(), t, t + 6);
+            }
+            else{
+                unsigned int t[6] = {(unsigned int)q[0], (unsigned int)q[1], (unsigned int)q[3],
+                    (unsigned int)q[1], (unsigned int)q[2], (unsigned int)q[3]};
+                mesh.triangles.insert(mesh.triangles.end(), t, t + 6);
+            }
+            nb_triangles += 2;
+        }
+    }
+
+    C2S_COUNT(TRIANGLES_EMITTED, nb_triangles);
+}
+
+
+template bool cell_vertex(const Lattice& L, uint64_t cell, const ScalarField& field, float target,
+    glm::vec3& position, glm::vec3& normal);
+template bool cell_vertex(const LatticeD& L, uint64_t cell, const ScalarFieldD& field, double target,
+    glm::vec3& position, glm::vec3& normal);
+template void dual_contour(const Lattice& L, const std::vector<uint64_t>& cells, const ScalarField& field, float target,
+    Mesh& mesh);
+template void dual_contour(const LatticeD& L, const std::vector<uint64_t>& cells, const ScalarFieldD& field, double target,
+    Mesh& mesh);
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "lattice.h"
+#include "extract.h"
+
+
+
+// Dual contouring: one vertex per cell crossed by the surface, at the point closest to the tangent planes
+// of the surface where it crosses the cell edges (the minimizer of their quadratic error function, QEF),
+// and one quad per crossed lattice edge joining the vertices of the 4 cells around it. Unlike marching
+// cubes, whose vertices are bound to the edges, a vertex can sit on a crease or a corner inside its cell,
+// so sharp features survive at a much coarser grid step
+
+// eigenvalues of a QEF below this fraction of the largest one are treated as 0: along those directions the
+// vertex stays at the mean of the crossings instead of being pushed away by nearly parallel planes
+const float qef_threshold = 0.1;
+
+// key of the vertex of a cell (packed key) in Mesh::keys, distinct from the lattice edge keys of marching
+// cubes vertices
+inline uint64_t dual_vertex_key(uint64_t cell) { return (cell << 2) | 3; }
+
+// vertex of cell (packed key) at level target, clamped to the cell, with the mean normal of the crossings.
+// Return false when the surface does not cross the cell or when a corner is missing from field or has no
+// support
+template<typename S>
+bool cell_vertex(const BasicLattice<S>& L, uint64_t cell, const BasicScalarField<S>& field, typename BasicLattice<S>::Scalar target,
+    glm::vec3& position, glm::vec3& normal);
+
+// contour the lattice edges starting at the origin vertex of each of cells (packed keys) at level target and
+// append 2 triangles per crossed edge to mesh. The cells around an edge lie partly below the given ones and
+// are read from field as well; edges with one of them missing or without support are skipped. Each edge
+// being contoured by a single cell, pieces contoured separately share the vertices of their border cells
+// (see dual_vertex_key) and weld without gap or overlap
+template<typename S>
+void dual_contour(const BasicLattice<S>& L, const std::vector<uint64_t>& cells, const BasicScalarField<S>& field, typename BasicLattice<S>::Scalar target,
+    Mesh& mesh);
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <unordered_map>
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "lattice.h"
+
+
+
+// indexed triangle mesh produced by the extractors
+struct Mesh{
+
+    std::vector<glm::vec3> vertices;
+    std::vector<glm::vec3> normals;
+    std::vector<uint64_t> keys;            // lattice edge each vertex lies on (cell for dual contouring), used
+                                           // to weld pieces
+    std::vector<unsigned int> triangles;   // 3 vertex indices per triangle
+
+    size_t nb_vertices() const { return vertices.size(); }
+    size_t nb_triangles() const { return triangles.size() / 3; }
+};
+
+
+// marching cubes tables, also used by the viewer (main.cpp)
+extern int aiCubeEdgeFlags[256];
+extern int a2iTriangleConnectionTable[256][16];
+
+
+// surface vertex on a lattice edge
+struct EdgeVertex{
+    uint64_t key;
+    glm::vec3 position;
+    glm::vec3 normal;
+};
+
+// polygonise one cell (packed key): vertices[e] is filled for each edge e crossed by the surface and
+// triangles receives triples of edge numbers. Return the number of triangles, 0 when the surface does
+// not cross the cell or when a corner is missing from field or has no support. Interpolation is done
+// at the precision of the lattice (float or double), vertices are stored as float
+template<typename S>
+int march_cell(const BasicLattice<S>& L, uint64_t cell, const BasicScalarField<S>& field, typename BasicLattice<S>::Scalar target, EdgeVertex vertices[12],
+    int triangles[15]);
+
+// polygonise the cells (packed keys) of lattice L at level target and append the triangles to mesh;
+// vertices are shared through the lattice edge they lie on and computed from the lower end of that
+// edge only, so pieces extracted separately meet on identical vertices. Cells with a corner missing
+// from field or without support are skipped
+template<typename S>
+void extract_mesh(const BasicLattice<S>& L, const std::vector<uint64_t>& cells, const BasicScalarField<S>& field, typename BasicLattice<S>::Scalar target, 
+    Mesh& mesh);
+
+
+// part of a mesh handed to a MeshWriter as soon as it is extracted
+struct MeshChunk{
+    std::vector<glm::vec3> vertices;       // vertices new in this chunk, numbered after those of previous chunks
+    std::vector<glm::vec3> normals;
+    std::vector<unsigned int> triangles;   // 3 vertex indices per triangle, among all vertices written so far
+    std::vector<glm::vec3> corners;        // positions of the 3 vertices of each triangle, for triangle soup formats
+
+    void clear() { vertices.clear(); normals.clear(); triangles.clear(); corners.clear(); }
+};
+
+// destination of a mesh written chunk by chunk, see mesh_writer.h for the file formats
+class MeshWriter{
+
+public:
+
+    virtual ~MeshWriter() {}
+
+    virtual bool begin(const char * path) = 0;
+    virtual bool write(const MeshChunk& chunk) = 0;
+    // complete the file, e.g. with the counts of its header
+    virtual bool end() = 0;
+};
+
+// same as above, the triangles going to writer (between its begin and end) every chunk_triangles triangles
+// instead of being kept: only the vertices of the lattice edges that later cells may still share are
+// indexed, i.e. those of the last two z slabs of cells. Vertices and triangles come in the same order as
+// in mesh when cells are sorted. Return false if writer fails
+template<typename S>
+bool extract_mesh(const BasicLattice<S>& L, const std::vector<uint64_t>& cells, const BasicScalarField<S>& field, typename BasicLattice<S>::Scalar target, 
+    MeshWriter& writer, size_t chunk_triangles = 1 << 16);
+
+
+// function to save a mesh as a .obj file
+bool saveOBJ(
+    const char * path,
+    const Mesh & mesh
+);
+
+// append piece to mesh, vertices on a lattice edge already in index are shared instead of copied
+void weld_mesh(Mesh& mesh, const Mesh& piece, std::unordered_map<uint64_t, unsigned int>& index);
@@ -0,0 +1,158 @@
+// Size and throughput of the sparse field format against raw float storage
+//
+// usage: FieldBenchmark [--fandisk path] [--sizes n,n,...] [--tmp dir] [--threads n]
+//
+// The field of fandisk and of synthetic clouds (sphere, torus, noisy plane) of each size is evaluated on
+// the lattice as Cloud2Surface does, then written as a sparse field file to tmp and mapped back. Results go
+// to stdout as csv, one line per cloud:
+//
+//   cloud,points,vertices,blocks,raw_bytes,file_bytes,ratio,encode_mb_s,decode_mb_s,region_us,max_error,triangles,decoded_triangles
+//
+// where raw_bytes is the field stored as a packed key and a float per vertex, throughputs are in MB of
+// raw field per second (encoding and writing, mapping and decoding every block), region_us is the time to
+// read back the vertices of a region of 16^3 cells at the center of the cloud, max_error is the largest
+// difference between decoded and evaluated values in grid steps, and the triangle counts are those of the
+// surface extracted from the evaluated and from the decoded field. The parameters are scaled with the
+// density of the cloud (density_params in bench_utils.h).
+
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "data.h"
+#include "rimls.h"
+#include "lattice.h"
+#include "extract.h"
+#include "sparse_field.h"
+#include "bench_utils.h"
+#include "synthetic.h"
+#include "parallel.h"
+
+
+static bool bench_cloud(const std::string& name, const std::vector<Data>& V, const std::string& tmp){
+
+    RimlsParams params = density_params(V.size());
+
+    Cube init_cube(V);
+    OctTree<Data>* OT = makeTree(V, init_cube);
+
+    Lattice L(glm::vec3(0.0, 0.0, 0.0), params.grid_step);
+    std::vector<uint64_t> cells;
+    const int bound = lattice_key_bias - 1;
+    activate_cells(V, L, 1, LatticeKey(-bound, -bound, -bound), LatticeKey(bound, bound, bound), cells);
+
+    ScalarField field;
+    rimls_lattice(cells, L, OT, init_cube, params, field);
+    delete OT;
+
+    std::string path = tmp + "/bench_" + name + ".sfield";
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    if(!write_sparse_field(path.c_str(), L, field))
+        return false;
+    double encode = seconds_since(start);
+
+    start = std::chrono::steady_clock::now();
+    SparseField file;
+    if(!file.load(path.c_str()))
+        return false;
+    ScalarField decoded;
+    if(!file.read_all(decoded))
+        return false;
+    double decode = seconds_since(start);
+
+    LatticeKey center = L.cell(glm::vec3(0.5, 0.5, 0.5));
+    start = std::chrono::steady_clock::now();
+    ScalarField region;
+    if(!file.read_region(LatticeKey(center.i - 8, center.j - 8, center.k - 8),
+        LatticeKey(center.i + 8, center.j + 8, center.k + 8), region))
+        return false;
+    double region_time = seconds_since(start);
+
+    double max_error = 0.0;
+    for(ScalarField::const_iterator it=field.begin(); it!=field.end(); it++){
+        ScalarField::const_iterator d = decoded.find(it->first);
+        if(d == decoded.end() || std::isnan(it->second.value) != std::isnan(d->second.value)){
+            printf("ERROR: %s: vertex lost by the sparse field\n", name.c_str());
+            return false;
+        }
+        if(!std::isnan(it->second.value))
+            max_error = std::max(max_error, double(std::fabs(it->second.value - d->second.value)));
+    }
+
+    Mesh mesh, decoded_mesh;
+    extract_mesh(L, cells, field, 0.0, mesh);
+    extract_mesh(L, cells, decoded, 0.0, decoded_mesh);
+
+    double raw = double(field.size()) * double(sizeof(uint64_t) + sizeof(float));
+    printf("%s,%lu,%lu,%lu,%.0f,%lu,%.2f,%.1f,%.1f,%.1f,%.3g,%lu,%lu\n", name.c_str(), (unsigned long)V.size(),
+        (unsigned long)field.size(), (unsigned long)file.nb_blocks(), raw, (unsigned long)file.file_size(),
+        raw / double(file.file_size()), raw / encode / 1e6, raw / decode / 1e6, region_time * 1e6,
+        max_error / double(params.grid_step), (unsigned long)mesh.nb_triangles(), (unsigned long)decoded_mesh.nb_triangles());
+    fflush(stdout);
+
+    remove(path.c_str());
+    return true;
+}
+
+
+int main(int argc, char **argv)
+{
+    const char * fandisk = "fandisk.obj";
+    std::string tmp = ".";
+    std::vector<size_t> sizes = {10000, 100000};
+
+    for(int i=1; i<argc; i++){
+        bool has_value = i+1 < argc;
+
+        if(strcmp(argv[i], "--fandisk") == 0 && has_value)
+            fandisk = argv[++i];
+        else if(strcmp(argv[i], "--tmp") == 0 && has_value)
+            tmp = argv[++i];
+        else if(strcmp(argv[i], "--threads") == 0 && has_value)
+            set_parallel_threads(atoi(argv[++i]));
+        else if(strcmp(argv[i], "--sizes") == 0 && has_value){
+            sizes.clear();
+            split_list(argv[++i], sizes);
+        }
+        else{
+            printf("usage: %s [--fandisk path] [--sizes n,n,...] [--tmp dir] [--threads n]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    printf("cloud,points,vertices,blocks,raw_bytes,file_bytes,ratio,encode_mb_s,decode_mb_s,region_us,max_error,triangles,"
+        "decoded_triangles\n");
+
+    std::vector<Data> V;
+    if(loadOBJ(fandisk, V) && !V.empty()){
+        Cube bounding_cube(V);
+        for(std::vector<Data>::iterator it=V.begin(); it!=V.end(); it++)
+            *it = Data(((*it).p() - bounding_cube.origin) / bounding_cube.scale, (*it).n());
+        if(!bench_cloud("fandisk", V, tmp))
+            return 1;
+    }
+    else
+        fprintf(stderr, "skipping fandisk\n");
+
+    const char * shapes[3] = {"sphere", "torus", "plane"};
+
+    for(std::vector<size_t>::const_iterator n=sizes.begin(); n!=sizes.end(); n++){
+        for(int s=0; s<3; s++){
+            V.clear();
+            if(s == 0)
+                sphere_cloud(*n, V);
+            else if(s == 1)
+                torus_cloud(*n, V);
+            else
+                noisy_plane_cloud(*n, 0.002, V);
+
+            if(!bench_cloud(std::string(shapes[s]) + "_" + std::to_string(*n), V, tmp))
+                return 1;
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,97 @@
+#include <cstdio>
+#include <cstring>
+
+#include "field_cache.h"
+#include "flat_tree.h"
+#include "stats.h"
+
+
+static const char field_cache_magic[4] = {'C', '2', 'S', 'F'};
+static const uint32_t field_cache_version = 1;
+
+struct FieldCacheHeader{
+    char magic[4];          // "C2SF"
+    uint32_t version;
+    uint64_t key;           // field_key of the evaluation
+    uint64_t nb_samples;
+};
+
+
+uint64_t field_key(uint64_t cloud, const Lattice& L, const RimlsParams& params, int dilation, const LatticeKey& lo,
+    const LatticeKey& hi){
+
+    // every input of the evaluation, field by field so that padding never enters the hash
+    float reals[9] = {L.origin.x, L.origin.y, L.origin.z, L.step, params.radius, params.grid_step, params.sigma_r,
+        params.sigma_n, params.fallback_radius};
+    int32_t integers[10] = {params.max_neighbors, params.max_iter, int32_t(params.fallback), dilation,
+        lo.i, lo.j, lo.k, hi.i, hi.j, hi.k};
+
+    uint64_t hash = hash_bytes(hash_basis, &cloud, sizeof(cloud));
+    hash = hash_bytes(hash, reals, sizeof(reals));
+    return hash_bytes(hash, integers, sizeof(integers));
+}
+
+
+bool save_field(const char * path, uint64_t key, const ScalarField& field){
+
+    C2S_TIMER("field cache");
+
+    FieldCacheHeader header;
+    memcpy(header.magic, field_cache_magic, 4);
+    header.version = field_cache_version;
+    header.key = key;
+    header.nb_samples = field.size();
+
+    // written aside then renamed, so that a reader never gets a partial file
+    std::string tmp = std::string(path) + ".tmp";
+    FILE * file = fopen(tmp.c_str(), "wb");
+    if(file == NULL){
+        printf("ERROR: cannot write field cache %s\n", path);
+        return false;
+    }
+
+    bool ok = fwrite(&header, sizeof(header), 1, file) == 1;
+    for(ScalarField::const_iterator it=field.begin(); ok && it!=field.end(); it++){
+        const FieldSample& F = it->second;
+        float values[4] = {F.value, F.gradient.x, F.gradient.y, F.gradient.z};
+        ok = fwrite(&it->first, sizeof(uint64_t), 1, file) == 1 && fwrite(values, sizeof(float), 4, file) == 4;
+    }
+    ok = (fclose(file) == 0) && ok;
+
+    if(!ok || rename(tmp.c_str(), path) != 0){
+        printf("ERROR: cannot write field cache %s\n", path);
+        remove(tmp.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool load_field(const char * path, uint64_t key, ScalarField& field){
+
+    C2S_TIMER("field cache");
+
+    FILE * file = fopen(path, "rb");
+    if(file == NULL)
+        return false;
+
+    FieldCacheHeader header;
+    bool ok = fread(&header, sizeof(header), 1, file) == 1 && memcmp(header.magic, field_cache_magic, 4) == 0
+        && header.version == field_cache_version && header.key == key;
+
+    ScalarField cached;
+    if(ok)
+        cached.reserve(header.nb_samples);
+    for(uint64_t n=0; ok && n<header.nb_samples; n++){
+        uint64_t vertex;
+        float values[4];
+        ok = fread(&vertex, sizeof(uint64_t), 1, file) == 1 && fread(values, sizeof(float), 4, file) == 4;
+        if(ok)
+            cached[vertex] = FieldSample(values[0], glm::vec3(values[1], values[2], values[3]));
+    }
+    fclose(file);
+
+    if(!ok)
+        return false;
+    field.swap(cached);
+    return true;
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstdint>
+
+#include "lattice.h"
+#include "rimls.h"
+
+
+
+// Evaluated fields kept on disk between runs, so that extracting another iso-value or re-running on
+// the same input skips the RIMLS evaluation. A cache file holds a header then one record per vertex:
+// packed key, value and gradient (4 floats). Only a file written under the same key is ever read back
+
+// key of the field evaluated from the points of content hash cloud (see cloud_hash) over the cells of
+// [lo, hi) activated with dilation, on lattice L with params
+uint64_t field_key(uint64_t cloud, const Lattice& L, const RimlsParams& params, int dilation, const LatticeKey& lo,
+    const LatticeKey& hi);
+
+bool save_field(const char * path, uint64_t key, const ScalarField& field);
+
+// read the field at path into field, return false if it is missing, not a field file or written under
+// another key, in which case the field should be evaluated
+bool load_field(const char * path, uint64_t key, ScalarField& field);
@@ -0,0 +1,291 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "flat_tree.h"
+#include "stats.h"
+
+
+static const char flat_tree_magic[4] = {'C', '2', 'S', 'T'};
+static const uint32_t flat_tree_version = 1;
+
+
+uint64_t hash_bytes(uint64_t hash, const void * bytes, size_t size){
+    const unsigned char * b = (const unsigned char *)bytes;
+    for(size_t i=0; i<size; i++){
+        hash ^= b[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+uint64_t cloud_hash(const std::vector<Data>& V, const Cube& init_cube){
+
+    uint64_t hash = hash_basis;
+    for(std::vector<Data>::const_iterator it=V.begin(); it!=V.end(); it++){
+        float values[6] = {(*it).p().x, (*it).p().y, (*it).p().z, (*it).n().x, (*it).n().y, (*it).n().z};
+        hash = hash_bytes(hash, values, sizeof(values));
+    }
+    float cube[4] = {init_cube.origin.x, init_cube.origin.y, init_cube.origin.z, init_cube.scale};
+    return hash_bytes(hash, cube, sizeof(cube));
+}
+
+
+FlatTree::FlatTree() : mapping(NULL), mapping_size(0), nodes(NULL), points(NULL), nb_nodes(0), nb_points(0), content_hash(0) {}
+
+FlatTree::~FlatTree(){
+    unmap();
+}
+
+void FlatTree::unmap(){
+    if(mapping != NULL)
+        munmap(mapping, mapping_size);
+    mapping = NULL;
+    mapping_size = 0;
+}
+
+
+// append the inner node O and its subtree, return its index
+static int32_t flatten(OctTree<Data>* O, std::vector<FlatNode>& nodes, std::vector<float>& points){
+
+    int32_t index = int32_t(nodes.size());
+    nodes.push_back(FlatNode());
+
+    for(int i=0; i<8; i++){
+        int32_t son = -1;
+        if(O->son(i) != nullptr && O->son(i)->isLeaf()){
+            const Data& D = O->son(i)->value();
+            son = -2 - int32_t(points.size() / 6);
+            float values[6] = {D.p().x, D.p().y, D.p().z, D.n().x, D.n().y, D.n().z};
+            points.insert(points.end(), values, values + 6);
+        }
+        else if(O->son(i) != nullptr)
+            son = flatten(O->son(i), nodes, points);
+        nodes[index].sons[i] = son;    // after the recursion, which may have moved nodes
+    }
+
+    return index;
+}
+
+void FlatTree::build(OctTree<Data>* OT, const Cube& cube, uint64_t hash){
+
+    unmap();
+    owned_nodes.clear();
+    owned_points.clear();
+    flatten(OT, owned_nodes, owned_points);
+
+    nodes = owned_nodes.data();
+    points = owned_points.data();
+    nb_nodes = owned_nodes.size();
+    nb_points = owned_points.size() / 6;
+    init_cube = Cube();
+    init_cube.origin = cube.origin;
+    init_cube.scale = cube.scale;
+    content_hash = hash;
+}
+
+
+bool FlatTree::save(const char * path) const{
+
+    C2S_TIMER("index");
+
+    FlatTreeHeader header;
+    memcpy(header.magic, flat_tree_magic, 4);
+    header.version = flat_tree_version;
+    header.hash = content_hash;
+    header.nb_nodes = nb_nodes;
+    header.nb_points = nb_points;
+    header.origin[0] = init_cube.origin.x;
+    header.origin[1] = init_cube.origin.y;
+    header.origin[2] = init_cube.origin.z;
+    header.scale = init_cube.scale;
+
+    // written aside then renamed, so that a reader never maps a partial file
+    std::string tmp = std::string(path) + ".tmp";
+    FILE * file = fopen(tmp.c_str(), "wb");
+    if(file == NULL){
+        printf("ERROR: cannot write index %s\n", path);
+        return false;
+    }
+
+    bool ok = fwrite(&header, sizeof(header), 1, file) == 1
+        && fwrite(nodes, sizeof(FlatNode), nb_nodes, file) == nb_nodes
+        && fwrite(points, 6*sizeof(float), nb_points, file) == nb_points;
+    ok = (fclose(file) == 0) && ok;
+
+    if(!ok || rename(tmp.c_str(), path) != 0){
+        printf("ERROR: cannot write index %s\n", path);
+        remove(tmp.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool FlatTree::load(const char * path, uint64_t hash){
+
+    C2S_TIMER("index");
+
+    int fd = open(path, O_RDONLY);
+    if(fd < 0)
+        return false;
+
+    struct stat st;
+    if(fstat(fd, &st) != 0 || size_t(st.st_size) < sizeof(FlatTreeHeader)){
+        close(fd);
+        return false;
+    }
+
+    void * map = mmap(NULL, size_t(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if(map == MAP_FAILED)
+        return false;
+
+    const FlatTreeHeader * header = (const FlatTreeHeader *)map;
+    bool valid = memcmp(header->magic, flat_tree_magic, 4) == 0 && header->version == flat_tree_version
+        && header->hash == hash && header->nb_nodes > 0
+        && size_t(st.st_size) == sizeof(FlatTreeHeader) + header->nb_nodes * sizeof(FlatNode)
+                                 + header->nb_points * 6 * sizeof(float);
+    if(!valid){
+        munmap(map, size_t(st.st_size));
+        return false;
+    }
+
+    unmap();
+    owned_nodes.clear();
+    owned_points.clear();
+    mapping = map;
+    mapping_size = size_t(st.st_size);
+
+    nodes = (const FlatNode *)((const char *)map + sizeof(FlatTreeHeader));
+    points = (const float *)(nodes + header->nb_nodes);
+    nb_nodes = header->nb_nodes;
+    nb_points = header->nb_points;
+    init_cube = Cube();
+    init_cube.origin = glm::vec3(header->origin[0], header->origin[1], header->origin[2]);
+    init_cube.scale = header->scale;
+    content_hash = hash;
+    return true;
+}
+
+
+// point stored as son of an inner node
+static Data flat_point(const float * points, int32_t son){
+    const float * p = points + 6 * size_t(-2 - son);
+    return Data(glm::vec3(p[0], p[1], p[2]), glm::vec3(p[3], p[4], p[5]));
+}
+
+Data FlatTree::point(int32_t son) const{
+    return flat_point(points, son);
+}
+
+
+// same traversal as find_neighbors on the OctTree, so that points come in the same order
+void FlatTree::radius_search(int32_t node, const Data& D, float r, std::vector<Data>& V, Cube C, int& counter) const{
+
+    const FlatNode& N = nodes[node];
+
+    for(int i=0; i<8; i++){
+        int32_t son = N.sons[i];
+        if(son == -1)
+            continue;
+        if(son < -1){
+            Data P = point(son);
+            if(D.dist(P) <= r && P != D)
+                V.push_back(P);
+        }
+        else{
+            counter++;
+            C.next_cube(i);
+            if(C.intersect_sphere(D.p(), r))
+                radius_search(son, D, r, V, C, counter);
+            C.previous_cube(i);
+        }
+    }
+}
+
+void FlatTree::find_neighbors(const Data& D, float r, std::vector<Data>& V, int& counter) const{
+    if(nb_nodes > 0)
+        radius_search(0, D, r, V, init_cube, counter);
+}
+
+
+typedef std::pair<float, Data> FlatCandidate;    // squared distance, point
+
+static bool farther(const FlatCandidate& A, const FlatCandidate& B){
+    return A.first < B.first;
+}
+
+// squared distance from X to the cube of given origin and scale, 0 inside
+static float cube_distance2(const glm::vec3& X, const glm::vec3& origin, float scale){
+    float d2 = 0.0;
+    for(int i=0; i<3; i++){
+        float d = glm::max(origin[i] - X[i], glm::max(float(0.0), X[i] - origin[i] - scale));
+        d2 += d*d;
+    }
+    return d2;
+}
+
+// same traversal as find_knn on the OctTree, heap holds the best candidates so far, farthest on top
+static void knn_search(const FlatNode * nodes, const float * points, int32_t node, const glm::vec3& X, size_t k,
+    const glm::vec3& origin, float scale, std::vector<FlatCandidate>& heap){
+
+    float half = scale / 2.0;
+    std::pair<float, int> sons[8];    // inner sons by distance of their cube
+    int nb_sons = 0;
+
+    for(int i=0; i<8; i++){
+        int32_t son = nodes[node].sons[i];
+        if(son == -1)
+            continue;
+        glm::vec3 corner = origin + half*cube_vertices[i];
+        if(son < -1){
+            Data P = flat_point(points, son);
+            glm::vec3 d = P.p() - X;
+            float d2 = scalar_product(d, d);
+            if(heap.size() < k){
+                heap.push_back(FlatCandidate(d2, P));
+                std::push_heap(heap.begin(), heap.end(), farther);
+            }
+            else if(d2 < heap.front().first){
+                std::pop_heap(heap.begin(), heap.end(), farther);
+                heap.back() = FlatCandidate(d2, P);
+                std::push_heap(heap.begin(), heap.end(), farther);
+            }
+        }
+        else
+            sons[nb_sons++] = std::pair<float, int>(cube_distance2(X, corner, half), i);
+    }
+
+    std::sort(sons, sons + nb_sons);
+
+    for(int n=0; n<nb_sons; n++){
+        if(heap.size() == k && sons[n].first > heap.front().first)
+            break;
+        C2S_COUNT(NODES_VISITED, 1);
+        int i = sons[n].second;
+        knn_search(nodes, points, nodes[node].sons[i], X, k, origin + half*cube_vertices[i], half, heap);
+    }
+}
+
+void FlatTree::find_knn(const glm::vec3& X, int k, std::vector<Data>& V) const{
+
+    C2S_COUNT(NEIGHBOR_QUERIES, 1);
+
+    V.clear();
+    if(k <= 0 || nb_nodes == 0)
+        return;
+
+    std::vector<FlatCandidate> heap;
+    heap.reserve(k);
+    knn_search(nodes, points, 0, X, size_t(k), init_cube.origin, init_cube.scale, heap);
+
+    std::sort_heap(heap.begin(), heap.end(), farther);
+    for(std::vector<FlatCandidate>::const_iterator it=heap.begin(); it!=heap.end(); it++)
+        V.push_back(it->second);
+
+    C2S_COUNT(NEIGHBORS_FOUND, V.size());
+}
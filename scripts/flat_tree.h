@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "data.h"
+#include "neighbor_index.h"
+
+
+
+// OctTree flattened into arrays, so that a tree can be written to disk and mapped back by a later run
+// instead of being rebuilt by makeTree. Nodes refer to their sons and points by index, the file is
+// therefore valid at any address: a header, the inner nodes (the root first), then the points as
+// 6 floats (position, normal) in the order of a depth first traversal
+struct FlatTreeHeader{
+    char magic[4];          // "C2ST"
+    uint32_t version;
+    uint64_t hash;          // cloud_hash of the points and cube the tree was built from
+    uint64_t nb_nodes;
+    uint64_t nb_points;
+    float origin[3];        // cube of the tree
+    float scale;
+};
+
+// sons of an inner node: -1 for none, the index of an inner node if >= 0, point p as -2 - p
+struct FlatNode{
+    int32_t sons[8];
+};
+
+
+// FNV-1a of size bytes, chained from hash (a previous result, or the offset basis below)
+const uint64_t hash_basis = 14695981039346656037ull;
+uint64_t hash_bytes(uint64_t hash, const void * bytes, size_t size);
+
+// content hash of the points of V, in order, and of the cube a tree is built on
+uint64_t cloud_hash(const std::vector<Data>& V, const Cube& init_cube);
+
+
+class FlatTree : public NeighborIndex{
+
+    std::vector<FlatNode> owned_nodes;      // built in memory
+    std::vector<float> owned_points;
+    void * mapping;                         // or mapped from a file
+    size_t mapping_size;
+
+    const FlatNode * nodes;
+    const float * points;
+    size_t nb_nodes, nb_points;
+    Cube init_cube;                         // without scalar field, copied at every level of a search
+    uint64_t content_hash;
+
+    Data point(int32_t son) const;
+    void unmap();
+    void radius_search(int32_t node, const Data& D, float r, std::vector<Data>& V, Cube C, int& counter) const;
+
+public:
+
+    FlatTree();
+    ~FlatTree();
+
+    FlatTree(const FlatTree&) = delete;
+    FlatTree& operator=(const FlatTree&) = delete;
+
+    // flatten OT, built by makeTree on init_cube from points whose cloud_hash is hash; OT can be deleted after
+    void build(OctTree<Data>* OT, const Cube& cube, uint64_t hash);
+
+    bool save(const char * path) const;
+    // map the file at path, return false if it is missing, not a tree file or built from other points than
+    // those of the given hash, in which case the tree should be rebuilt
+    bool load(const char * path, uint64_t hash);
+
+    size_t size() const { return nb_points; }
+
+    void find_neighbors(const Data& D, float r, std::vector<Data>& V, int& counter) const;
+    void find_knn(const glm::vec3& X, int k, std::vector<Data>& V) const;
+};
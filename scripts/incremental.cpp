@@ -0,0 +1,173 @@
+#include <algorithm>
+#include <cmath>
+
+#include "incremental.h"
+#include "stats.h"
+
+
+Reconstruction::Reconstruction(const std::vector<Data>& V, const Cube& init_cube, const RimlsParams& params, int dilation,
+    float target) : init_cube(init_cube), L(init_cube.origin, params.grid_step), params(params), dilation(dilation),
+    target(target), evaluated(0){
+
+    OT = makeTree(V, init_cube);
+
+    std::vector<uint64_t> dirty;
+    activate(V, dirty);
+
+    cells.insert(dirty.begin(), dirty.end());
+    update(dirty);
+}
+
+Reconstruction::~Reconstruction(){
+    delete OT;
+}
+
+
+void Reconstruction::activate(const std::vector<Data>& V, std::vector<uint64_t>& activated) const{
+    LatticeKey lo = L.cell(init_cube.origin);
+    LatticeKey hi = L.cell(init_cube.origin + init_cube.scale*glm::vec3(1.0, 1.0, 1.0));
+    activate_cells(V, L, dilation, LatticeKey(lo.i - dilation, lo.j - dilation, lo.k - dilation),
+        LatticeKey(hi.i + dilation + 1, hi.j + dilation + 1, hi.k + dilation + 1), activated);
+}
+
+void Reconstruction::update(const std::vector<uint64_t>& dirty){
+
+    size_t before = field.size();
+    rimls_lattice(dirty, L, OT, init_cube, params, field);
+    evaluated = field.size() - before;
+
+    EdgeVertex edges[12];
+    int triangles[15];
+
+    for(std::vector<uint64_t>::const_iterator it=dirty.begin(); it!=dirty.end(); it++){
+        // vertices only used by the previous triangles of the cell go with them
+        std::unordered_map<uint64_t, std::vector<uint64_t> >::iterator old = surface.find(*it);
+        if(old != surface.end()){
+            for(std::vector<uint64_t>::const_iterator e=old->second.begin(); e!=old->second.end(); e++){
+                std::unordered_map<uint64_t, unsigned int>::iterator count = references.find(*e);
+                if(--count->second == 0){
+                    references.erase(count);
+                    vertices.erase(*e);
+                }
+            }
+            surface.erase(old);
+        }
+
+        int n = march_cell(L, *it, field, target, edges, triangles);
+        if(n == 0)
+            continue;
+
+        std::vector<uint64_t>& S = surface[*it];
+        for(int c=0; c<3*n; c++){
+            const EdgeVertex& E = edges[triangles[c]];
+            S.push_back(E.key);
+            vertices[E.key] = E;
+            references[E.key]++;
+        }
+    }
+
+    updated = dirty;
+}
+
+
+size_t Reconstruction::insert(const std::vector<Data>& V){
+
+    C2S_TIMER("insert");
+
+    std::vector<Data> added;
+    for(std::vector<Data>::const_iterator it=V.begin(); it!=V.end(); it++){
+        if(insertTree(OT, *it, init_cube))
+            added.push_back(*it);
+    }
+
+    updated.clear();
+    evaluated = 0;
+    if(added.empty())
+        return 0;
+
+    // evaluated vertices with a new point within reach (the radius, or the fallback radius with the
+    // kNN fallback): the new points lie in their seed cell, so only vertices within reach of that cell
+    // can see them
+    std::vector<uint64_t> seeds;
+    for(std::vector<Data>::const_iterator it=added.begin(); it!=added.end(); it++)
+        seeds.push_back(pack_key(L.cell((*it).p())));
+    std::sort(seeds.begin(), seeds.end());
+    seeds.erase(std::unique(seeds.begin(), seeds.end()), seeds.end());
+
+    int R = int(std::ceil(params.reach() / L.step));
+    float reach = (params.reach() / L.step) * (params.reach() / L.step);
+    std::unordered_set<uint64_t> stale;
+
+    for(std::vector<uint64_t>::const_iterator it=seeds.begin(); it!=seeds.end(); it++){
+        LatticeKey S = unpack_key(*it);
+        for(int k=S.k-R; k<=S.k+1+R; k++){
+            int dk = (k < S.k) ? S.k - k : glm::max(0, k - S.k - 1);
+            for(int j=S.j-R; j<=S.j+1+R; j++){
+                int dj = (j < S.j) ? S.j - j : glm::max(0, j - S.j - 1);
+                for(int i=S.i-R; i<=S.i+1+R; i++){
+                    int di = (i < S.i) ? S.i - i : glm::max(0, i - S.i - 1);
+                    if(float(di*di + dj*dj + dk*dk) > reach)
+                        continue;
+                    uint64_t key = pack_key(LatticeKey(i, j, k));
+                    if(field.count(key))
+                        stale.insert(key);
+                }
+            }
+        }
+    }
+
+    // cells activated by the new points, and active cells with a stale corner
+    std::vector<uint64_t> activated;
+    activate(added, activated);
+
+    std::unordered_set<uint64_t> dirty;
+    for(std::vector<uint64_t>::const_iterator it=activated.begin(); it!=activated.end(); it++){
+        if(cells.insert(*it).second)
+            dirty.insert(*it);
+    }
+
+    for(std::unordered_set<uint64_t>::const_iterator it=stale.begin(); it!=stale.end(); it++){
+        LatticeKey V = unpack_key(*it);
+        for(int v=0; v<8; v++){
+            uint64_t cell = pack_key(LatticeKey(V.i - int(cube_vertices[v].x), V.j - int(cube_vertices[v].y),
+                V.k - int(cube_vertices[v].z)));
+            if(cells.count(cell))
+                dirty.insert(cell);
+        }
+        field.erase(*it);
+    }
+
+    std::vector<uint64_t> sorted(dirty.begin(), dirty.end());
+    std::sort(sorted.begin(), sorted.end());
+    update(sorted);
+
+    return added.size();
+}
+
+
+void Reconstruction::mesh(Mesh& M) const{
+
+    std::vector<uint64_t> keys;
+    for(std::unordered_map<uint64_t, std::vector<uint64_t> >::const_iterator it=surface.begin(); it!=surface.end(); it++)
+        keys.push_back(it->first);
+    std::sort(keys.begin(), keys.end());
+
+    std::unordered_map<uint64_t, unsigned int> index;    // lattice edge -> vertex of M
+
+    for(std::vector<uint64_t>::const_iterator it=keys.begin(); it!=keys.end(); it++){
+        const std::vector<uint64_t>& S = surface.find(*it)->second;
+        for(std::vector<uint64_t>::const_iterator e=S.begin(); e!=S.end(); e++){
+            std::unordered_map<uint64_t, unsigned int>::const_iterator found = index.find(*e);
+            if(found != index.end()){
+                M.triangles.push_back(found->second);
+                continue;
+            }
+            const EdgeVertex& E = vertices.find(*e)->second;
+            index[*e] = (unsigned int)M.vertices.size();
+            M.triangles.push_back((unsigned int)M.vertices.size());
+            M.vertices.push_back(E.position);
+            M.normals.push_back(E.normal);
+            M.keys.push_back(E.key);
+        }
+    }
+}
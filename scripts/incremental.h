@@ -0,0 +1,58 @@
+#pragma once
+
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "rimls.h"
+#include "extract.h"
+
+
+
+// Reconstruction kept in memory between scanner passes: new points go into the existing tree and
+// only the lattice vertices within RimlsParams::reach() of them are evaluated again, only the cells
+// touching those vertices (or activated by the new points) are extracted again
+class Reconstruction{
+
+    OctNode<Data>* OT;
+    Cube init_cube;
+    Lattice L;
+    RimlsParams params;
+    int dilation;
+    float target;
+
+    std::unordered_set<uint64_t> cells;                               // active cells
+    ScalarField field;
+    std::unordered_map<uint64_t, std::vector<uint64_t> > surface;    // cell -> triangles, as triples of lattice edges
+    std::unordered_map<uint64_t, EdgeVertex> vertices;              // lattice edge -> surface vertex
+    std::unordered_map<uint64_t, unsigned int> references;          // lattice edge -> uses in surface
+
+    std::vector<uint64_t> updated;    // cells extracted by the last update
+    size_t evaluated;                 // vertices evaluated by the last update
+
+    // cells activated by V on the part of the lattice covering init_cube
+    void activate(const std::vector<Data>& V, std::vector<uint64_t>& activated) const;
+    // evaluate the missing vertices of dirty cells and extract them again
+    void update(const std::vector<uint64_t>& dirty);
+
+    Reconstruction(const Reconstruction&) = delete;
+    Reconstruction& operator=(const Reconstruction&) = delete;
+
+public:
+
+    // the tree covers init_cube, points inserted later must fall inside it
+    Reconstruction(const std::vector<Data>& V, const Cube& init_cube, const RimlsParams& params, int dilation, float target);
+    ~Reconstruction();
+
+    // insert a batch of points and update the surface around them, return the number of points added
+    // (points outside init_cube or already in the tree are left out)
+    size_t insert(const std::vector<Data>& V);
+
+    // cells (packed keys) extracted by the last construction or insertion
+    const std::vector<uint64_t>& changed() const { return updated; }
+    // lattice vertices evaluated by the last construction or insertion
+    size_t nb_evaluated() const { return evaluated; }
+
+    // current surface, cells in key order
+    void mesh(Mesh& M) const;
+};
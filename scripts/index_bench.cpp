@@ -0,0 +1,256 @@
+// Benchmark of the spatial indexes on skewed and anisotropic scans
+//
+// usage: IndexBenchmark [--clouds c,c,...] [--sizes n,n,...] [--queries n] [--k n]
+//
+// Each cloud is built from a synthetic shape (synthetic.h) then distorted the way real scans are:
+//
+//   strip      noisy plane squeezed to a strip 40 times longer than wide
+//   tower      cylinder stretched 10 times along its axis
+//   falloff    sphere scanned from one side, the density dropping 100 times across it
+//   scanlines  box whose points are snapped to scan lines 8 times farther apart than the points on a line
+//
+// normalized to the unit cube, and indexed by the OctTree (makeTree) and by the kd-tree (kd_tree.h).
+// Both then answer the same kNN queries and radius queries at positions near the surface, as the lattice
+// vertices of the reconstruction; the radius is the median distance of the k-th nearest point to a query,
+// so that radius queries find about k points whatever the distortion of the cloud.
+// Results go to stdout as csv, one line per cloud, size and index:
+//
+//   cloud,points,index,build_s,radius_ns,knn_ns,nodes_per_query,neighbors_per_query
+//
+// nodes_per_query counts the inner nodes visited by a radius query. The program fails if the kd-tree
+// does not find the same points as the OctTree.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "data.h"
+#include "rimls.h"
+#include "kd_tree.h"
+#include "neighbor_index.h"
+#include "synthetic.h"
+#include "bench_utils.h"
+
+
+// scale the points of V by factors around the center of the unit cube, normals following
+static void stretch(std::vector<Data>& V, const glm::vec3& factors){
+    glm::vec3 center(0.5, 0.5, 0.5);
+    for(std::vector<Data>::iterator it=V.begin(); it!=V.end(); it++){
+        glm::vec3 n = (*it).n() / factors;
+        *it = Data(center + ((*it).p() - center) * factors, n / euclidean_norm(n));
+    }
+}
+
+static bool make_cloud(const std::string& name, size_t n, std::vector<Data>& V){
+
+    V.clear();
+
+    if(name == "strip"){
+        noisy_plane_cloud(n, 0.001, V);
+        stretch(V, glm::vec3(1.0, 0.025, 1.0));
+    }
+    else if(name == "tower"){
+        cylinder_cloud(n, V);
+        stretch(V, glm::vec3(1.0, 1.0, 10.0));
+    }
+    else if(name == "falloff"){
+        // keep a point with a probability going from 1 to 1/100 along x
+        std::vector<Data> all;
+        sphere_cloud(n * 5, all);
+        std::mt19937 generator(1);
+        std::uniform_real_distribution<float> uniform(0.0, 1.0);
+        for(std::vector<Data>::const_iterator it=all.begin(); it!=all.end() && V.size()<n; it++){
+            float t = ((*it).p().x - 0.1) / 0.8;
+            if(uniform(generator) < std::pow(0.01f, t))
+                V.push_back(*it);
+        }
+    }
+    else if(name == "scanlines"){
+        box_cloud(n, V);
+        float spacing = 0.6 / std::sqrt(float(n) / 6.0);    // of the points on a face
+        float line = 8.0 * spacing;
+        for(std::vector<Data>::iterator it=V.begin(); it!=V.end(); it++){
+            glm::vec3 p = (*it).p();
+            p.y = 0.2 + line * std::floor((p.y - 0.2) / line + 0.5);
+            *it = Data(p, (*it).n());
+        }
+    }
+    else{
+        printf("ERROR: unknown cloud %s\n", name.c_str());
+        return false;
+    }
+
+    if(V.size() < 2){
+        printf("ERROR: cloud %s has too few points\n", name.c_str());
+        return false;
+    }
+
+    Cube bounding_cube(V);
+    for(std::vector<Data>::iterator it=V.begin(); it!=V.end(); it++)
+        *it = Data(((*it).p() - bounding_cube.origin) / bounding_cube.scale, (*it).n());
+    return true;
+}
+
+
+struct IndexResult{
+    double build, radius, knn;    // seconds in total
+    size_t nodes, neighbors;
+};
+
+// answer the queries with index, keeping the neighbors found for the comparison
+static void run_queries(const NeighborIndex& index, const std::vector<Data>& queries, float radius, int k,
+    IndexResult& result, std::vector<std::vector<Data> >& found, std::vector<std::vector<Data> >& nearest){
+
+    found.assign(queries.size(), std::vector<Data>());
+    nearest.assign(queries.size(), std::vector<Data>());
+    int counter = 0;
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for(size_t q=0; q<queries.size(); q++)
+        index.find_neighbors(queries[q], radius, found[q], counter);
+    result.radius = seconds_since(start);
+
+    start = std::chrono::steady_clock::now();
+    for(size_t q=0; q<queries.size(); q++)
+        index.find_knn(queries[q].p(), k, nearest[q]);
+    result.knn = seconds_since(start);
+
+    result.nodes = size_t(counter);
+    result.neighbors = 0;
+    for(size_t q=0; q<queries.size(); q++)
+        result.neighbors += found[q].size();
+}
+
+static bool by_position(const Data& A, const Data& B){
+    if(A.p().x != B.p().x) return A.p().x < B.p().x;
+    if(A.p().y != B.p().y) return A.p().y < B.p().y;
+    return A.p().z < B.p().z;
+}
+
+// same points within the radius, same distances to the k nearest
+static size_t mismatches(const std::vector<Data>& queries, std::vector<std::vector<Data> >& found_a,
+    std::vector<std::vector<Data> >& found_b, const std::vector<std::vector<Data> >& nearest_a,
+    const std::vector<std::vector<Data> >& nearest_b){
+
+    size_t count = 0;
+    for(size_t q=0; q<queries.size(); q++){
+        std::sort(found_a[q].begin(), found_a[q].end(), by_position);
+        std::sort(found_b[q].begin(), found_b[q].end(), by_position);
+        bool same = found_a[q] == found_b[q] && nearest_a[q].size() == nearest_b[q].size();
+        for(size_t i=0; same && i<nearest_a[q].size(); i++){
+            glm::vec3 da = nearest_a[q][i].p() - queries[q].p();
+            glm::vec3 db = nearest_b[q][i].p() - queries[q].p();
+            same = scalar_product(da, da) == scalar_product(db, db);
+        }
+        if(!same)
+            count++;
+    }
+    return count;
+}
+
+
+int main(int argc, char **argv)
+{
+    std::vector<std::string> clouds;
+    std::vector<size_t> sizes;
+    size_t nb_queries = 100000;
+    int k = 20;
+
+    for(int i=1; i<argc; i++){
+        bool has_value = i+1 < argc;
+
+        if(strcmp(argv[i], "--clouds") == 0 && has_value)
+            split_list(argv[++i], clouds);
+        else if(strcmp(argv[i], "--sizes") == 0 && has_value)
+            split_list(argv[++i], sizes);
+        else if(strcmp(argv[i], "--queries") == 0 && has_value)
+            nb_queries = size_t(atof(argv[++i]));
+        else if(strcmp(argv[i], "--k") == 0 && has_value)
+            k = atoi(argv[++i]);
+        else{
+            printf("usage: %s [--clouds c,c,...] [--sizes n,n,...] [--queries n] [--k n]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    if(clouds.empty())
+        split_list("strip,tower,falloff,scanlines", clouds);
+    if(sizes.empty())
+        sizes.push_back(1000000);
+
+    printf("cloud,points,index,build_s,radius_ns,knn_ns,nodes_per_query,neighbors_per_query\n");
+
+    size_t failures = 0;
+
+    for(std::vector<std::string>::const_iterator cloud=clouds.begin(); cloud!=clouds.end(); cloud++){
+        for(std::vector<size_t>::const_iterator size=sizes.begin(); size!=sizes.end(); size++){
+
+            std::vector<Data> V;
+            if(!make_cloud(*cloud, *size, V))
+                return 1;
+
+            RimlsParams params = density_params(V.size());
+
+            // lattice vertices near the surface: points moved by up to a grid step
+            std::vector<Data> queries;
+            std::mt19937 generator(2);
+            std::uniform_int_distribution<size_t> pick(0, V.size() - 1);
+            std::uniform_real_distribution<float> offset(-params.grid_step, params.grid_step);
+            for(size_t q=0; q<nb_queries; q++){
+                glm::vec3 p = V[pick(generator)].p() + glm::vec3(offset(generator), offset(generator), offset(generator));
+                queries.push_back(Data(p, glm::vec3(0.0, 0.0, 0.0)));
+            }
+
+            Cube init_cube(V);
+            IndexResult octree, kd;
+            std::vector<std::vector<Data> > found_octree, found_kd, nearest_octree, nearest_kd;
+
+            std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            OctTree<Data>* OT = makeTree(V, init_cube);
+            octree.build = seconds_since(start);
+
+            std::vector<float> kth;
+            for(size_t q=0; q<queries.size() && q<1000; q++){
+                std::vector<Data> nearest;
+                find_knn(OT, queries[q].p(), k, nearest, init_cube);
+                kth.push_back(euclidean_distance(nearest.back().p(), queries[q].p()));
+            }
+            std::nth_element(kth.begin(), kth.begin() + kth.size() / 2, kth.end());
+            float radius = kth[kth.size() / 2];
+
+            run_queries(OctTreeIndex(OT, init_cube), queries, radius, k, octree, found_octree, nearest_octree);
+            delete OT;
+
+            start = std::chrono::steady_clock::now();
+            {
+                KdTree tree(V, init_cube);
+                kd.build = seconds_since(start);
+                run_queries(tree, queries, radius, k, kd, found_kd, nearest_kd);
+            }
+
+            const char * names[2] = {"octree", "kdtree"};
+            const IndexResult * results[2] = {&octree, &kd};
+            for(int r=0; r<2; r++){
+                const IndexResult& R = *results[r];
+                printf("%s,%lu,%s,%.4f,%.1f,%.1f,%.2f,%.2f\n", cloud->c_str(), (unsigned long)V.size(), names[r],
+                    R.build, R.radius * 1e9 / double(nb_queries), R.knn * 1e9 / double(nb_queries),
+                    double(R.nodes) / double(nb_queries), double(R.neighbors) / double(nb_queries));
+            }
+            fflush(stdout);
+
+            size_t different = mismatches(queries, found_octree, found_kd, nearest_octree, nearest_kd);
+            if(different > 0){
+                fprintf(stderr, "MISMATCH: %s %lu points, %lu queries answered differently by the kd-tree\n",
+                    cloud->c_str(), (unsigned long)V.size(), (unsigned long)different);
+                failures++;
+            }
+        }
+    }
+
+    return failures > 0 ? 1 : 0;
+}
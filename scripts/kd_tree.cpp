@@ -0,0 +1,278 @@
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "kd_tree.h"
+#include "parallel.h"
+#include "stats.h"
+
+
+// nodes of the subtrees over n and n + 1 points: a node over more than kd_leaf_points points gives n / 2 to
+// its left son and the rest to its right one, so that both only depend on subtrees over n / 2 and n / 2 + 1
+static void subtree_nodes(size_t n, size_t& nodes_n, size_t& nodes_n1){
+
+    if(n + 1 <= kd_leaf_points){
+        nodes_n = nodes_n1 = 1;
+        return;
+    }
+
+    size_t m = n / 2;
+    size_t nodes_m, nodes_m1;
+    subtree_nodes(m, nodes_m, nodes_m1);
+
+    if(n % 2 == 0){
+        nodes_n = (n <= kd_leaf_points) ? 1 : 1 + 2 * nodes_m;
+        nodes_n1 = 1 + nodes_m + nodes_m1;
+    }
+    else{
+        nodes_n = (n <= kd_leaf_points) ? 1 : 1 + nodes_m + nodes_m1;
+        nodes_n1 = 1 + 2 * nodes_m1;
+    }
+}
+
+static size_t subtree_nodes(size_t n){
+    size_t nodes_n, nodes_n1;
+    subtree_nodes(n, nodes_n, nodes_n1);
+    return nodes_n;
+}
+
+
+template<typename S>
+BasicKdTree<S>::BasicKdTree(const std::vector<BasicData<S> >& V, const BasicCube<S>& init_cube){
+
+    C2S_TIMER("tree");
+
+    // points inside the cube, the first of each position
+    std::vector<uint32_t> order;
+    for(size_t i=0; i<V.size(); i++){
+        if(init_cube.contains(V[i].p()))
+            order.push_back(uint32_t(i));
+    }
+
+    parallel_sort(order, [&](uint32_t a, uint32_t b){
+        const glm::tvec3<S>& A = V[a].p();
+        const glm::tvec3<S>& B = V[b].p();
+        if(A.x != B.x) return A.x < B.x;
+        if(A.y != B.y) return A.y < B.y;
+        if(A.z != B.z) return A.z < B.z;
+        return a < b;
+    });
+    size_t n = 0;
+    for(size_t i=0; i<order.size(); i++){
+        if(n == 0 || V[order[i]].p() != V[order[n - 1]].p())
+            order[n++] = order[i];
+    }
+    order.resize(n);
+
+    if(n == 0)
+        return;
+
+    // median partitioning, one level at a time, the nodes of a level in parallel
+    struct Task{
+        uint32_t node, begin, end;
+    };
+    nodes.resize(subtree_nodes(n));
+    std::vector<Task> level(1, Task{0, 0, uint32_t(n)});
+
+    while(!level.empty()){
+
+        std::vector<Task> next(2 * level.size(), Task{0, 0, 0});
+
+        parallel_for(level.size(), [&](size_t begin, size_t end){
+            for(size_t t=begin; t<end; t++){
+                const Task& T = level[t];
+                Node& N = nodes[T.node];
+                N.begin = T.begin;
+                N.end = T.end;
+                N.right = 0;
+
+                for(int a=0; a<3; a++)
+                    N.lo[a] = N.hi[a] = V[order[T.begin]].p()[a];
+                for(uint32_t i=T.begin + 1; i<T.end; i++){
+                    const glm::tvec3<S>& P = V[order[i]].p();
+                    for(int a=0; a<3; a++){
+                        N.lo[a] = std::min(N.lo[a], P[a]);
+                        N.hi[a] = std::max(N.hi[a], P[a]);
+                    }
+                }
+
+                uint32_t size = T.end - T.begin;
+                if(size <= kd_leaf_points)
+                    continue;
+
+                int axis = 0;
+                for(int a=1; a<3; a++){
+                    if(N.hi[a] - N.lo[a] > N.hi[axis] - N.lo[axis])
+                        axis = a;
+                }
+
+                uint32_t middle = T.begin + size / 2;
+                std::nth_element(order.begin() + T.begin, order.begin() + middle, order.begin() + T.end,
+                    [&](uint32_t a, uint32_t b){ return V[a].p()[axis] < V[b].p()[axis]; });
+
+                N.right = T.node + 1 + uint32_t(subtree_nodes(size / 2));
+                next[2*t] = Task{T.node + 1, T.begin, middle};
+                next[2*t + 1] = Task{N.right, middle, T.end};
+            }
+        });
+
+        level.clear();
+        for(typename std::vector<Task>::const_iterator it=next.begin(); it!=next.end(); it++){
+            if(it->end > it->begin)
+                level.push_back(*it);
+        }
+    }
+
+    x.resize(n); y.resize(n); z.resize(n);
+    nx.resize(n); ny.resize(n); nz.resize(n);
+    parallel_for(n, [&](size_t begin, size_t end){
+        for(size_t i=begin; i<end; i++){
+            const BasicData<S>& D = V[order[i]];
+            x[i] = D.p().x; y[i] = D.p().y; z[i] = D.p().z;
+            nx[i] = D.n().x; ny[i] = D.n().y; nz[i] = D.n().z;
+        }
+    });
+}
+
+
+template<typename S>
+BasicData<S> BasicKdTree<S>::point(uint32_t p) const{
+    return BasicData<S>(glm::tvec3<S>(x[p], y[p], z[p]), glm::tvec3<S>(nx[p], ny[p], nz[p]));
+}
+
+// same arithmetic as the distances of the OctTree, so that a point is found by one exactly when it is by the other
+template<typename S>
+void BasicKdTree<S>::leaf_distances(const Node& N, const glm::tvec3<S>& X, S d2[]) const{
+
+    const S * px = x.data() + N.begin;
+    const S * py = y.data() + N.begin;
+    const S * pz = z.data() + N.begin;
+    uint32_t size = N.end - N.begin;
+
+    for(uint32_t i=0; i<size; i++){
+        S dx = X.x - px[i];
+        S dy = X.y - py[i];
+        S dz = X.z - pz[i];
+        d2[i] = dx*dx + dy*dy + dz*dz;
+    }
+}
+
+// squared distance from X to the box [lo, hi], 0 inside; never more than the distance computed to a point in the box
+template<typename S>
+static S box_distance2(const glm::tvec3<S>& X, const S lo[3], const S hi[3]){
+    S d2 = 0.0;
+    for(int a=0; a<3; a++){
+        S d = std::max(lo[a] - X[a], std::max(S(0.0), X[a] - hi[a]));
+        d2 += d*d;
+    }
+    return d2;
+}
+
+
+template<typename S>
+void BasicKdTree<S>::radius_search(uint32_t node, const BasicData<S>& D, S r, S r2, std::vector<BasicData<S> >& V,
+    int& counter) const{
+
+    const Node& N = nodes[node];
+
+    if(N.right == 0){
+        S d2[kd_leaf_points];
+        leaf_distances(N, D.p(), d2);
+        for(uint32_t i=0; i<N.end - N.begin; i++){
+            if(d2[i] > r2 || std::sqrt(d2[i]) > r)
+                continue;
+            BasicData<S> P = point(N.begin + i);
+            if(P != D)
+                V.push_back(P);
+        }
+        return;
+    }
+
+    counter++;
+    uint32_t sons[2] = {node + 1, N.right};
+    for(int s=0; s<2; s++){
+        const Node& son = nodes[sons[s]];
+        if(box_distance2(D.p(), son.lo, son.hi) <= r2)
+            radius_search(sons[s], D, r, r2, V, counter);
+    }
+}
+
+template<typename S>
+void BasicKdTree<S>::find_neighbors(const BasicData<S>& D, S r, std::vector<BasicData<S> >& V, int& counter) const{
+
+    if(nodes.empty())
+        return;
+
+    // bound on the squared distances whose root is at most r, so that the exact test is only made near r
+    S r2 = r * r * (S(1.0) + S(8.0) * std::numeric_limits<S>::epsilon());
+    if(box_distance2(D.p(), nodes[0].lo, nodes[0].hi) <= r2)
+        radius_search(0, D, r, r2, V, counter);
+}
+
+
+template<typename S>
+static bool farther(const std::pair<S, uint32_t>& A, const std::pair<S, uint32_t>& B){
+    return A.first < B.first;
+}
+
+// heap holds the best candidates so far, farthest on top
+template<typename S>
+void BasicKdTree<S>::knn_search(uint32_t node, const glm::tvec3<S>& X, size_t k, std::vector<Candidate>& heap) const{
+
+    const Node& N = nodes[node];
+
+    if(N.right == 0){
+        S d2[kd_leaf_points];
+        leaf_distances(N, X, d2);
+        for(uint32_t i=0; i<N.end - N.begin; i++){
+            if(heap.size() < k){
+                heap.push_back(Candidate(d2[i], N.begin + i));
+                std::push_heap(heap.begin(), heap.end(), farther<S>);
+            }
+            else if(d2[i] < heap.front().first){
+                std::pop_heap(heap.begin(), heap.end(), farther<S>);
+                heap.back() = Candidate(d2[i], N.begin + i);
+                std::push_heap(heap.begin(), heap.end(), farther<S>);
+            }
+        }
+        return;
+    }
+
+    // nearest son first
+    std::pair<S, uint32_t> sons[2] = {
+        std::pair<S, uint32_t>(box_distance2(X, nodes[node + 1].lo, nodes[node + 1].hi), node + 1),
+        std::pair<S, uint32_t>(box_distance2(X, nodes[N.right].lo, nodes[N.right].hi), N.right)};
+    if(sons[1].first < sons[0].first)
+        std::swap(sons[0], sons[1]);
+
+    for(int s=0; s<2; s++){
+        if(heap.size() == k && sons[s].first > heap.front().first)
+            break;
+        C2S_COUNT(NODES_VISITED, 1);
+        knn_search(sons[s].second, X, k, heap);
+    }
+}
+
+template<typename S>
+void BasicKdTree<S>::find_knn(const glm::tvec3<S>& X, int k, std::vector<BasicData<S> >& V) const{
+
+    C2S_COUNT(NEIGHBOR_QUERIES, 1);
+
+    V.clear();
+    if(k <= 0 || nodes.empty())
+        return;
+
+    std::vector<Candidate> heap;
+    heap.reserve(k);
+    knn_search(0, X, size_t(k), heap);
+
+    std::sort_heap(heap.begin(), heap.end(), farther<S>);
+    for(typename std::vector<Candidate>::const_iterator it=heap.begin(); it!=heap.end(); it++)
+        V.push_back(point(it->second));
+
+    C2S_COUNT(NEIGHBORS_FOUND, V.size());
+}
+
+
+template class BasicKdTree<float>;
+template class BasicKdTree<double>;
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "data.h"
+#include "neighbor_index.h"
+
+
+
+// Balanced kd-tree over the points of a cloud, an index for the scans the OctTree handles worst: density far
+// from uniform (dense near the scanner and along its scan lines) or clouds much longer or flatter along one
+// axis than the others, where the cubes of the OctTree are mostly empty and its paths long. Each node splits
+// its points at the median along the longest side of their bounding box, so that the depth stays
+// log2(n / kd_leaf_points) whatever the distribution; the levels are partitioned on parallel_threads() threads.
+//
+// Points are stored in leaf order as separate arrays of coordinates, a leaf being a run of kd_leaf_points / 2
+// to kd_leaf_points entries whose distances to a query are computed by a loop the compiler vectorizes.
+// As makeTree, the tree keeps the points inside init_cube and the first of the points at a same position, so
+// that searches return the same points as the OctTree (up to ties in distance at the k-th of find_knn)
+
+// most points in a leaf, a leaf holds at least half as many unless the whole cloud is smaller
+const uint32_t kd_leaf_points = 32;
+
+template<typename S>
+class BasicKdTree : public BasicNeighborIndex<S>{
+
+    struct Node{
+        S lo[3], hi[3];          // bounding box of the points below
+        uint32_t begin, end;     // points below
+        uint32_t right;          // index of the right son, the left one is next to the node; 0 for a leaf
+    };
+
+    typedef std::pair<S, uint32_t> Candidate;    // squared distance, point
+
+    std::vector<Node> nodes;                     // depth first, the root first
+    std::vector<S> x, y, z, nx, ny, nz;          // points in leaf order
+
+    BasicData<S> point(uint32_t p) const;
+    // squared distances from X to the points of leaf N, into d2
+    void leaf_distances(const Node& N, const glm::tvec3<S>& X, S d2[]) const;
+    void radius_search(uint32_t node, const BasicData<S>& D, S r, S r2, std::vector<BasicData<S> >& V, int& counter) const;
+    void knn_search(uint32_t node, const glm::tvec3<S>& X, size_t k, std::vector<Candidate>& heap) const;
+
+public:
+
+    // build the tree over the points of V inside init_cube
+    BasicKdTree(const std::vector<BasicData<S> >& V, const BasicCube<S>& init_cube);
+
+    size_t size() const { return x.size(); }
+
+    void find_neighbors(const BasicData<S>& D, S r, std::vector<BasicData<S> >& V, int& counter) const;
+    void find_knn(const glm::tvec3<S>& X, int k, std::vector<BasicData<S> >& V) const;
+};
+
+typedef BasicKdTree<float> KdTree;
+typedef BasicKdTree<double> KdTreeD;
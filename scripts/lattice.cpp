@@ -0,0 +1,88 @@
+#include <algorithm>
+#include <cmath>
+
+#include "lattice.h"
+
+
+uint64_t pack_key(const LatticeKey& K){
+    const uint64_t mask = (uint64_t(1) << lattice_key_bits) - 1;
+
+    uint64_t i = uint64_t(K.i + lattice_key_bias) & mask;
+    uint64_t j = uint64_t(K.j + lattice_key_bias) & mask;
+    uint64_t k = uint64_t(K.k + lattice_key_bias) & mask;
+
+    return (k << (2*lattice_key_bits)) | (j << lattice_key_bits) | i;
+}
+
+LatticeKey unpack_key(uint64_t key){
+    const uint64_t mask = (uint64_t(1) << lattice_key_bits) - 1;
+
+    int i = int(key & mask) - lattice_key_bias;
+    int j = int((key >> lattice_key_bits) & mask) - lattice_key_bias;
+    int k = int((key >> (2*lattice_key_bits)) & mask) - lattice_key_bias;
+
+    return LatticeKey(i, j, k);
+}
+
+
+template<typename S>
+LatticeKey BasicLattice<S>::cell(const Vec& X) const{
+    return LatticeKey(int(std::floor((X.x - origin.x) / step)),
+                      int(std::floor((X.y - origin.y) / step)),
+                      int(std::floor((X.z - origin.z) / step)));
+}
+
+template<typename S>
+typename BasicLattice<S>::Vec BasicLattice<S>::vertex(const LatticeKey& K) const{
+    return Vec(origin.x + S(K.i)*step, origin.y + S(K.j)*step, origin.z + S(K.k)*step);
+}
+
+
+template<typename S>
+void activate_cells(const std::vector<BasicData<S> >& V, const BasicLattice<S>& L, int dilation,
+    const LatticeKey& lo, const LatticeKey& hi, std::vector<uint64_t>& cells){
+
+    // cells holding points first, so that dense regions are dilated only once
+    std::vector<uint64_t> seeds;
+    seeds.reserve(V.size());
+    for(typename std::vector<BasicData<S> >::const_iterator it=V.begin(); it!=V.end(); it++)
+        seeds.push_back(pack_key(L.cell((*it).p())));
+
+    std::sort(seeds.begin(), seeds.end());
+    seeds.erase(std::unique(seeds.begin(), seeds.end()), seeds.end());
+
+    size_t first = cells.size();
+
+    for(std::vector<uint64_t>::const_iterator it=seeds.begin(); it!=seeds.end(); it++){
+        LatticeKey C = unpack_key(*it);
+
+        for(int dk=-dilation; dk<=dilation; dk++){
+            int k = C.k + dk;
+            if(k < lo.k || k >= hi.k)
+                continue;
+            for(int dj=-dilation; dj<=dilation; dj++){
+                int j = C.j + dj;
+                if(j < lo.j || j >= hi.j)
+                    continue;
+                for(int di=-dilation; di<=dilation; di++){
+                    int i = C.i + di;
+                    if(i < lo.i || i >= hi.i)
+                        continue;
+                    cells.push_back(pack_key(LatticeKey(i, j, k)));
+                }
+            }
+        }
+    }
+
+    std::sort(cells.begin() + first, cells.end());
+    cells.erase(std::unique(cells.begin() + first, cells.end()), cells.end());
+}
+
+
+template class BasicLattice<float>;
+template class BasicLattice<double>;
+
+template void activate_cells(const std::vector<Data>& V, const Lattice& L, int dilation,
+    const LatticeKey& lo, const LatticeKey& hi, std::vector<uint64_t>& cells);
+template void activate_cells(const std::vector<DataD>& V, const LatticeD& L, int dilation,
+    const LatticeKey& lo, const LatticeKey& hi, std::vector<uint64_t>& cells);
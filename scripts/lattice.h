@@ -0,0 +1,90 @@
+#pragma once
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "data.h"
+
+
+
+// integer coordinates of a lattice vertex (or of the cell whose origin vertex it is)
+struct LatticeKey{
+    int i, j, k;
+
+    LatticeKey() : i(0), j(0), k(0) {}
+    LatticeKey(int a, int b, int c) : i(a), j(b), k(c) {}
+
+    bool operator==(const LatticeKey& K) const { return i==K.i && j==K.j && k==K.k; }
+    bool operator!=(const LatticeKey& K) const { return !(*this==K); }
+};
+
+
+// keys are packed on 20 bits per axis (k most significant, so that sorted keys come in z slabs),
+// biased so that slightly negative indices (halo) stay valid
+const int lattice_key_bits = 20;
+const int lattice_key_bias = 1 << (lattice_key_bits - 1);
+
+uint64_t pack_key(const LatticeKey& K);
+LatticeKey unpack_key(uint64_t key);
+
+// global id of the lattice edge starting at vertex K along axis (0: x, 1: y, 2: z)
+inline uint64_t edge_key(const LatticeKey& K, int axis) { return (pack_key(K) << 2) | uint64_t(axis); }
+
+
+// regular lattice shared by every piece of a reconstruction, so that cells and vertices
+// computed independently (bricks, workers, levels) always fall on the same positions
+template<typename S>
+class BasicLattice{
+
+public:
+
+    typedef S Scalar;
+    typedef glm::tvec3<S> Vec;
+
+    Vec origin;
+    S step;
+
+    BasicLattice() : origin(0.0, 0.0, 0.0), step(1.0) {}
+    BasicLattice(Vec O, S s) : origin(O), step(s) {}
+    // conversion from another scalar type
+    template<typename T>
+    explicit BasicLattice(const BasicLattice<T>& L) : origin(Vec(L.origin)), step(S(L.step)) {}
+
+    // cell containing X
+    LatticeKey cell(const Vec& X) const;
+    // position of vertex K, always computed the same way so that it is bitwise reproducible
+    Vec vertex(const LatticeKey& K) const;
+};
+
+typedef BasicLattice<float> Lattice;
+typedef BasicLattice<double> LatticeD;
+
+
+// value and gradient of the implicit function at a lattice vertex
+template<typename S>
+struct BasicFieldSample{
+    S value;
+    glm::tvec3<S> gradient;
+
+    BasicFieldSample() : value(0.0), gradient(0.0, 0.0, 0.0) {}
+    BasicFieldSample(S v, glm::tvec3<S> g) : value(v), gradient(g) {}
+};
+
+typedef BasicFieldSample<float> FieldSample;
+typedef BasicFieldSample<double> FieldSampleD;
+
+// sparse scalar field indexed by packed vertex keys, NaN values mark vertices without support
+template<typename S>
+using BasicScalarField = std::unordered_map<uint64_t, BasicFieldSample<S> >;
+
+typedef BasicScalarField<float> ScalarField;
+typedef BasicScalarField<double> ScalarFieldD;
+
+
+// append to cells the (packed) keys of the cells containing each point, dilated by dilation cells,
+// keeping only cells whose key lies in [lo, hi); duplicates are removed. Instantiated for float and double
+template<typename S>
+void activate_cells(const std::vector<BasicData<S> >& V, const BasicLattice<S>& L, int dilation,
+    const LatticeKey& lo, const LatticeKey& hi, std::vector<uint64_t>& cells);
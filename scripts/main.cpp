@@ -62,11 +62,12 @@ int main()
 	float grid_step = 1.0;
 	float sigma_r = 0.5;
 	float sigma_n = 1;
+	int max_neighbors = 10;
 	int max_iter = 3;
 
 	printf("rimls\n");
 
-	rimls(v, grid, radius, grid_step, sigma_r, sigma_n, max_iter);
+	rimls(v, grid, radius, grid_step, sigma_r, sigma_n, max_neighbors, max_iter, FALLBACK_KNN);
 
 	printf("done\n");
 
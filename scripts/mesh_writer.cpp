@@ -0,0 +1,370 @@
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "mesh_writer.h"
+#include "parallel.h"
+#include "stats.h"
+
+
+// buffers are written out by blocks of at least this size
+static const size_t write_block = size_t(8) << 20;
+
+// items encoded by a thread at once
+static const size_t encode_grain = 4096;
+
+static const size_t ply_vertex_bytes = 6 * sizeof(float);
+static const size_t ply_face_bytes = 1 + 3 * sizeof(int32_t);
+static const size_t stl_header_bytes = 80 + sizeof(uint32_t);
+static const size_t stl_triangle_bytes = 12 * sizeof(float) + sizeof(uint16_t);
+
+
+// append to buffer the encodings of items [0, n), encode(i, out) appending item i to out; items are encoded
+// in parallel by blocks, each block is then copied at the offset given by the sizes of the blocks before it
+template<typename Encode>
+static void encode_parallel(size_t n, std::vector<char>& buffer, const Encode& encode){
+
+    size_t nb_blocks = (n + encode_grain - 1) / encode_grain;
+    std::vector<std::vector<char> > blocks(nb_blocks);
+    parallel_for(nb_blocks, [&](size_t begin, size_t end){
+        for(size_t b=begin; b<end; b++){
+            for(size_t i=b*encode_grain; i<std::min(n, (b+1)*encode_grain); i++)
+                encode(i, blocks[b]);
+        }
+    });
+
+    std::vector<size_t> offsets(nb_blocks + 1, buffer.size());
+    for(size_t b=0; b<nb_blocks; b++)
+        offsets[b+1] = offsets[b] + blocks[b].size();
+    buffer.resize(offsets[nb_blocks]);
+    parallel_for(nb_blocks, [&](size_t begin, size_t end){
+        for(size_t b=begin; b<end; b++){
+            if(!blocks[b].empty())
+                memcpy(&buffer[offsets[b]], blocks[b].data(), blocks[b].size());
+        }
+    });
+}
+
+// fixed size records: encode(i, out) writes record_size bytes at out, each thread straight at its offset
+template<typename Encode>
+static void encode_records(size_t n, size_t record_size, std::vector<char>& buffer, const Encode& encode){
+
+    size_t offset = buffer.size();
+    buffer.resize(offset + n * record_size);
+    parallel_for(n, [&](size_t begin, size_t end){
+        for(size_t i=begin; i<end; i++)
+            encode(i, &buffer[offset + i * record_size]);
+    });
+}
+
+// counts are zero padded to a fixed width so that the header can be rewritten in place once they are known
+static void ply_header(char * text, size_t nb_vertices, size_t nb_triangles){
+    sprintf(text, "ply\nformat binary_little_endian 1.0\nelement vertex %012lu\n"
+        "property float x\nproperty float y\nproperty float z\nproperty float nx\nproperty float ny\nproperty float nz\n"
+        "element face %012lu\nproperty list uchar int vertex_indices\nend_header\n",
+        (unsigned long)nb_vertices, (unsigned long)nb_triangles);
+}
+
+static void append_text(std::vector<char>& out, const char * text, int length){
+    out.insert(out.end(), text, text + length);
+}
+
+static void put_floats(char * out, const glm::vec3& a, const glm::vec3& b){
+    float values[6] = {a.x, a.y, a.z, b.x, b.y, b.z};
+    memcpy(out, values, sizeof(values));
+}
+
+static void put_face(char * out, unsigned int a, unsigned int b, unsigned int c){
+    int32_t indices[3] = {int32_t(a), int32_t(b), int32_t(c)};
+    out[0] = 3;
+    memcpy(out + 1, indices, sizeof(indices));
+}
+
+static void put_facet(char * out, const glm::vec3& a, const glm::vec3& b, const glm::vec3& c){
+    glm::vec3 n = glm::cross(b - a, c - a);
+    float norm = euclidean_norm(n);
+    if(norm > 0.0)
+        n = n / norm;
+    float values[12] = {n.x, n.y, n.z, a.x, a.y, a.z, b.x, b.y, b.z, c.x, c.y, c.z};
+    memcpy(out, values, sizeof(values));
+    memset(out + sizeof(values), 0, sizeof(uint16_t));
+}
+
+
+BufferedMeshWriter::BufferedMeshWriter() : file(NULL), origin(0.0, 0.0, 0.0), scale(1.0), nb_vertices(0), nb_triangles(0) {}
+
+BufferedMeshWriter::~BufferedMeshWriter(){
+    if(file != NULL)
+        fclose(file);
+}
+
+bool BufferedMeshWriter::begin(const char * p){
+    path = p;
+    buffer.clear();
+    nb_vertices = 0;
+    nb_triangles = 0;
+    file = fopen(p, "wb");
+    if(file == NULL){
+        printf("ERROR: cannot write mesh %s\n", p);
+        return false;
+    }
+    return true;
+}
+
+bool BufferedMeshWriter::flush(bool force){
+    if(buffer.empty() || (!force && buffer.size() < write_block))
+        return true;
+
+    C2S_TIMER("write");
+
+    bool ok = fwrite(buffer.data(), 1, buffer.size(), file) == buffer.size();
+    buffer.clear();
+    if(!ok)
+        printf("ERROR: cannot write mesh %s\n", path.c_str());
+    return ok;
+}
+
+bool BufferedMeshWriter::end(){
+    bool ok = flush(true);
+    ok = (fclose(file) == 0) && ok;
+    file = NULL;
+    return ok;
+}
+
+
+bool OBJWriter::write(const MeshChunk& chunk){
+
+    encode_parallel(chunk.vertices.size(), buffer, [&](size_t i, std::vector<char>& out){
+        char line[128];
+        glm::vec3 P = transform(chunk.vertices[i]);
+        append_text(out, line, sprintf(line, "vn %f %f %f\n", chunk.normals[i].x, chunk.normals[i].y, chunk.normals[i].z));
+        append_text(out, line, sprintf(line, "v %f %f %f\n", P.x, P.y, P.z));
+    });
+
+    encode_parallel(chunk.triangles.size() / 3, buffer, [&](size_t i, std::vector<char>& out){
+        char line[128];
+        const unsigned int* t = &chunk.triangles[3*i];
+        append_text(out, line, sprintf(line, "f %u//%u %u//%u %u//%u\n", t[0]+1, t[0]+1, t[1]+1, t[1]+1, t[2]+1, t[2]+1));
+    });
+
+    nb_vertices += chunk.vertices.size();
+    nb_triangles += chunk.triangles.size() / 3;
+    return flush();
+}
+
+
+PLYWriter::PLYWriter() : faces(NULL) {}
+
+PLYWriter::~PLYWriter(){
+    if(faces != NULL){
+        fclose(faces);
+        remove((path + ".faces").c_str());
+    }
+}
+
+
+bool PLYWriter::begin(const char * p){
+    if(!BufferedMeshWriter::begin(p))
+        return false;
+    faces = fopen((path + ".faces").c_str(), "w+b");
+    if(faces == NULL){
+        printf("ERROR: cannot write mesh %s.faces\n", p);
+        return false;
+    }
+    face_buffer.clear();
+
+    char text[512];
+    ply_header(text, 0, 0);
+    append_text(buffer, text, int(strlen(text)));
+    return true;
+}
+
+bool PLYWriter::write(const MeshChunk& chunk){
+
+    encode_records(chunk.vertices.size(), ply_vertex_bytes, buffer, [&](size_t i, char * out){
+        put_floats(out, transform(chunk.vertices[i]), chunk.normals[i]);
+    });
+    encode_records(chunk.triangles.size() / 3, ply_face_bytes, face_buffer, [&](size_t i, char * out){
+        put_face(out, chunk.triangles[3*i], chunk.triangles[3*i+1], chunk.triangles[3*i+2]);
+    });
+
+    nb_vertices += chunk.vertices.size();
+    nb_triangles += chunk.triangles.size() / 3;
+
+    if(face_buffer.size() >= write_block){
+        if(fwrite(face_buffer.data(), 1, face_buffer.size(), faces) != face_buffer.size()){
+            printf("ERROR: cannot write mesh %s.faces\n", path.c_str());
+            return false;
+        }
+        face_buffer.clear();
+    }
+    return flush();
+}
+
+bool PLYWriter::end(){
+
+    bool ok = flush(true);
+
+    // spilled faces after the vertices
+    ok = ok && fwrite(face_buffer.data(), 1, face_buffer.size(), faces) == face_buffer.size();
+    face_buffer.clear();
+    ok = ok && fseek(faces, 0, SEEK_SET) == 0;
+    std::vector<char> block(write_block);
+    for(size_t n=0; ok && (n = fread(block.data(), 1, block.size(), faces)) > 0; )
+        ok = fwrite(block.data(), 1, n, file) == n;
+
+    char text[512];
+    ply_header(text, nb_vertices, nb_triangles);
+    ok = ok && fseek(file, 0, SEEK_SET) == 0 && fwrite(text, 1, strlen(text), file) == strlen(text);
+
+    fclose(faces);
+    faces = NULL;
+    remove((path + ".faces").c_str());
+
+    ok = (fclose(file) == 0) && ok;
+    file = NULL;
+    if(!ok)
+        printf("ERROR: cannot write mesh %s\n", path.c_str());
+    return ok;
+}
+
+
+bool STLWriter::begin(const char * p){
+    if(!BufferedMeshWriter::begin(p))
+        return false;
+    buffer.resize(stl_header_bytes, 0);    // count written by end
+    return true;
+}
+
+bool STLWriter::write(const MeshChunk& chunk){
+
+    encode_records(chunk.triangles.size() / 3, stl_triangle_bytes, buffer, [&](size_t i, char * out){
+        put_facet(out, transform(chunk.corners[3*i]), transform(chunk.corners[3*i+1]), transform(chunk.corners[3*i+2]));
+    });
+
+    nb_vertices += chunk.vertices.size();
+    nb_triangles += chunk.triangles.size() / 3;
+    return flush();
+}
+
+bool STLWriter::end(){
+    bool ok = flush(true);
+    uint32_t count = uint32_t(nb_triangles);
+    ok = ok && fseek(file, 80, SEEK_SET) == 0 && fwrite(&count, sizeof(count), 1, file) == 1;
+    ok = (fclose(file) == 0) && ok;
+    file = NULL;
+    if(!ok)
+        printf("ERROR: cannot write mesh %s\n", path.c_str());
+    return ok;
+}
+
+
+BufferedMeshWriter* make_mesh_writer(const std::string& format){
+    if(format == "obj")
+        return new OBJWriter();
+    if(format == "ply")
+        return new PLYWriter();
+    if(format == "stl")
+        return new STLWriter();
+    return NULL;
+}
+
+
+// write size bytes of part i at offsets[i] of fd, encoded by encode(i, out), on parallel_threads() threads
+template<typename Encode>
+static bool write_parts(int fd, size_t nb_parts, const std::vector<size_t>& offsets, const Encode& encode){
+
+    std::atomic<bool> ok(true);
+    parallel_for(nb_parts, [&](size_t begin, size_t end){
+        std::vector<char> out;
+        for(size_t i=begin; i<end && ok; i++){
+            out.clear();
+            encode(i, out);
+            if(pwrite(fd, out.data(), out.size(), off_t(offsets[i])) != ssize_t(out.size()))
+                ok = false;
+        }
+    });
+    return ok;
+}
+
+bool save_mesh(const char * path, const Mesh& mesh){
+
+    std::string name(path);
+    std::string format = name.size() > 4 ? name.substr(name.size() - 3) : "";
+
+    if(format == "obj"){
+        OBJWriter writer;
+        MeshChunk chunk;
+        chunk.vertices = mesh.vertices;
+        chunk.normals = mesh.normals;
+        chunk.triangles = mesh.triangles;
+        return writer.begin(path) && writer.write(chunk) && writer.end();
+    }
+
+    if(format != "ply" && format != "stl"){
+        printf("ERROR: unknown mesh format %s\n", path);
+        return false;
+    }
+
+    C2S_TIMER("write");
+
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if(fd < 0){
+        printf("ERROR: cannot write mesh %s\n", path);
+        return false;
+    }
+
+    size_t nb_vertices = mesh.nb_vertices();
+    size_t nb_triangles = mesh.nb_triangles();
+    std::vector<char> head;
+    if(format == "ply"){
+        char text[512];
+        ply_header(text, nb_vertices, nb_triangles);
+        head.assign(text, text + strlen(text));
+    }
+    else{
+        head.assign(stl_header_bytes, 0);
+        uint32_t count = uint32_t(nb_triangles);
+        memcpy(&head[80], &count, sizeof(count));
+    }
+
+    bool ok = pwrite(fd, head.data(), head.size(), 0) == ssize_t(head.size());
+
+    // parts of encode_grain vertices then encode_grain triangles, at offsets known from the counts
+    size_t vertex_parts = (format == "ply") ? (nb_vertices + encode_grain - 1) / encode_grain : 0;
+    size_t triangle_parts = (nb_triangles + encode_grain - 1) / encode_grain;
+    size_t triangle_start = head.size() + ((format == "ply") ? nb_vertices * ply_vertex_bytes : 0);
+    size_t triangle_bytes = (format == "ply") ? ply_face_bytes : stl_triangle_bytes;
+
+    std::vector<size_t> offsets(vertex_parts + triangle_parts);
+    for(size_t p=0; p<vertex_parts; p++)
+        offsets[p] = head.size() + p * encode_grain * ply_vertex_bytes;
+    for(size_t p=0; p<triangle_parts; p++)
+        offsets[vertex_parts + p] = triangle_start + p * encode_grain * triangle_bytes;
+
+    ok = ok && ftruncate(fd, off_t(triangle_start + nb_triangles * triangle_bytes)) == 0;
+    ok = ok && write_parts(fd, offsets.size(), offsets, [&](size_t p, std::vector<char>& out){
+        if(p < vertex_parts){
+            size_t first = p * encode_grain, last = std::min(nb_vertices, first + encode_grain);
+            out.resize((last - first) * ply_vertex_bytes);
+            for(size_t i=first; i<last; i++)
+                put_floats(&out[(i - first) * ply_vertex_bytes], mesh.vertices[i], mesh.normals[i]);
+            return;
+        }
+        size_t first = (p - vertex_parts) * encode_grain, last = std::min(nb_triangles, first + encode_grain);
+        out.resize((last - first) * triangle_bytes);
+        for(size_t i=first; i<last; i++){
+            const unsigned int* t = &mesh.triangles[3*i];
+            if(format == "ply")
+                put_face(&out[(i - first) * triangle_bytes], t[0], t[1], t[2]);
+            else
+                put_facet(&out[(i - first) * triangle_bytes], mesh.vertices[t[0]], mesh.vertices[t[1]], mesh.vertices[t[2]]);
+        }
+    });
+
+    ok = (close(fd) == 0) && ok;
+    if(!ok)
+        printf("ERROR: cannot write mesh %s\n", path);
+    return ok;
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "extract.h"
+
+
+
+// Mesh files written chunk by chunk (see MeshWriter), so that a mesh never has to be held whole: chunks
+// are encoded on parallel_threads() threads into a buffer, each part at an offset computed from the
+// sizes of the parts before it, and the buffer is written out in large blocks. Binary formats are little
+// endian, as the hosts they are written on
+//
+//   obj: text, v and vn lines of each chunk before its f lines
+//   ply: binary, vertices with normals then triangles; the triangles are spilled to path.faces until end
+//        since the number of vertices, which comes first, is only known then
+//   stl: binary, one record per triangle with its facet normal
+//
+// Vertices can be mapped by an affine transform (e.g. back from the unit cube to the cloud coordinates)
+class BufferedMeshWriter : public MeshWriter{
+
+protected:
+
+    FILE * file;
+    std::string path;
+    std::vector<char> buffer;
+    glm::vec3 origin;
+    float scale;
+    size_t nb_vertices, nb_triangles;
+
+    // write out the buffer if it is larger than the block size, or in any case with force
+    bool flush(bool force = false);
+    glm::vec3 transform(const glm::vec3& X) const { return origin + X * scale; }
+
+public:
+
+    BufferedMeshWriter();
+    ~BufferedMeshWriter();
+
+    // vertices written as origin + X * scale
+    void set_transform(const glm::vec3& o, float s) { origin = o; scale = s; }
+
+    size_t vertices() const { return nb_vertices; }
+    size_t triangles() const { return nb_triangles; }
+
+    bool begin(const char * path);
+    bool end();
+};
+
+class OBJWriter : public BufferedMeshWriter{
+
+public:
+
+    bool write(const MeshChunk& chunk);
+};
+
+class PLYWriter : public BufferedMeshWriter{
+
+    FILE * faces;
+    std::vector<char> face_buffer;
+
+public:
+
+    PLYWriter();
+    ~PLYWriter();
+
+    bool begin(const char * path);
+    bool write(const MeshChunk& chunk);
+    bool end();
+};
+
+class STLWriter : public BufferedMeshWriter{
+
+public:
+
+    bool begin(const char * path);
+    bool write(const MeshChunk& chunk);
+    bool end();
+};
+
+// writer for a format name (obj, ply or stl), NULL for an unknown one; to be deleted by the caller
+BufferedMeshWriter* make_mesh_writer(const std::string& format);
+
+
+// save a whole mesh in the format of the extension of path (.obj, .ply or .stl). Binary formats have fixed
+// size records, so the file is sized first and every thread writes its part at its final offset
+bool save_mesh(const char * path, const Mesh& mesh);
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "data.h"
+
+
+
+// spatial index over the points of a cloud, answering the queries of the reconstruction; implementations
+// must return the same points as the OctTree built by makeTree so that results do not depend on the index
+template<typename S>
+class BasicNeighborIndex{
+
+public:
+
+    virtual ~BasicNeighborIndex() {}
+
+    // points within r of D, D itself excluded, in no particular order; counter is incremented by the
+    // number of inner nodes visited
+    virtual void find_neighbors(const BasicData<S>& D, S r, std::vector<BasicData<S> >& V, int& counter) const = 0;
+
+    // the k points nearest to X, nearest first
+    virtual void find_knn(const glm::tvec3<S>& X, int k, std::vector<BasicData<S> >& V) const = 0;
+};
+
+typedef BasicNeighborIndex<float> NeighborIndex;
+typedef BasicNeighborIndex<double> NeighborIndexD;
+
+
+// index over an OctTree built by makeTree on init_cube, which stays owned by the caller
+template<typename S>
+class BasicOctTreeIndex : public BasicNeighborIndex<S>{
+
+    OctTree<BasicData<S> >* OT;
+    BasicCube<S> init_cube;
+
+public:
+
+    BasicOctTreeIndex(OctTree<BasicData<S> >* T, const BasicCube<S>& C) : OT(T), init_cube(C) {}
+
+    void find_neighbors(const BasicData<S>& D, S r, std::vector<BasicData<S> >& V, int& counter) const {
+        ::find_neighbors(OT, D, r, V, init_cube, false, counter);
+    }
+
+    void find_knn(const glm::tvec3<S>& X, int k, std::vector<BasicData<S> >& V) const {
+        ::find_knn(OT, X, k, V, init_cube);
+    }
+};
+
+typedef BasicOctTreeIndex<float> OctTreeIndex;
+typedef BasicOctTreeIndex<double> OctTreeIndexD;
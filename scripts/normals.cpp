@@ -0,0 +1,232 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <queue>
+#include <unordered_map>
+
+#include "normals.h"
+#include "parallel.h"
+#include "stats.h"
+
+
+// unit eigenvector of the smallest eigenvalue of the symmetric matrix A (a00, a01, a02, a11, a12, a22)
+static glm::dvec3 smallest_eigenvector(const double A[6]){
+
+    double a00 = A[0], a01 = A[1], a02 = A[2], a11 = A[3], a12 = A[4], a22 = A[5];
+
+    // eigenvalues by the trigonometric method
+    double p1 = a01*a01 + a02*a02 + a12*a12;
+    double q = (a00 + a11 + a22) / 3.0;
+    double p2 = (a00-q)*(a00-q) + (a11-q)*(a11-q) + (a22-q)*(a22-q) + 2.0*p1;
+
+    if(p2 <= 1e-30)    // isotropic, any direction will do
+        return glm::dvec3(0.0, 0.0, 1.0);
+
+    double p = std::sqrt(p2 / 6.0);
+    double b00 = (a00-q)/p, b11 = (a11-q)/p, b22 = (a22-q)/p, b01 = a01/p, b02 = a02/p, b12 = a12/p;
+    double r = (b00*(b11*b22 - b12*b12) - b01*(b01*b22 - b12*b02) + b02*(b01*b12 - b11*b02)) / 2.0;
+    r = glm::clamp(r, -1.0, 1.0);
+    double phi = std::acos(r) / 3.0;
+    double smallest = q + 2.0*p*std::cos(phi + 2.0*M_PI/3.0);
+    double largest = q + 2.0*p*std::cos(phi);
+
+    // the eigenvector is orthogonal to the rows of A - smallest I, take the best conditioned cross product
+    glm::dvec3 r0(a00 - smallest, a01, a02);
+    glm::dvec3 r1(a01, a11 - smallest, a12);
+    glm::dvec3 r2(a02, a12, a22 - smallest);
+
+    glm::dvec3 candidates[3] = {glm::cross(r0, r1), glm::cross(r0, r2), glm::cross(r1, r2)};
+    int best = 0;
+    double norm = 0.0;
+    for(int c=0; c<3; c++){
+        double n = glm::dot(candidates[c], candidates[c]);
+        if(n > norm){
+            norm = n;
+            best = c;
+        }
+    }
+
+    if(norm > 1e-12 * p2 * p2)
+        return candidates[best] / std::sqrt(norm);
+
+    // smallest eigenvalue is double (points along a line): any direction orthogonal to the largest one
+    r0 = glm::dvec3(a00 - largest, a01, a02);
+    r1 = glm::dvec3(a01, a11 - largest, a12);
+    r2 = glm::dvec3(a02, a12, a22 - largest);
+    glm::dvec3 line = glm::cross(r0, r1);
+    if(glm::dot(line, line) < glm::dot(glm::cross(r0, r2), glm::cross(r0, r2)))
+        line = glm::cross(r0, r2);
+    if(glm::dot(line, line) < glm::dot(glm::cross(r1, r2), glm::cross(r1, r2)))
+        line = glm::cross(r1, r2);
+
+    glm::dvec3 axis = (std::fabs(line.x) < std::fabs(line.z)) ? glm::dvec3(1.0, 0.0, 0.0) : glm::dvec3(0.0, 0.0, 1.0);
+    glm::dvec3 N = glm::cross(line, axis);
+    double length = std::sqrt(glm::dot(N, N));
+    return (length > 0.0) ? N / length : glm::dvec3(0.0, 0.0, 1.0);
+}
+
+static glm::vec3 pca_normal(const std::vector<Data>& neighbors){
+
+    glm::dvec3 mean(0.0, 0.0, 0.0);
+    for(std::vector<Data>::const_iterator it=neighbors.begin(); it!=neighbors.end(); it++)
+        mean += glm::dvec3((*it).p().x, (*it).p().y, (*it).p().z);
+    mean = mean / double(neighbors.size());
+
+    double A[6] = {0.0, 0.0, 0.0, 0.0, 0.0, 0.0};
+    for(std::vector<Data>::const_iterator it=neighbors.begin(); it!=neighbors.end(); it++){
+        glm::dvec3 d = glm::dvec3((*it).p().x, (*it).p().y, (*it).p().z) - mean;
+        A[0] += d.x*d.x;
+        A[1] += d.x*d.y;
+        A[2] += d.x*d.z;
+        A[3] += d.y*d.y;
+        A[4] += d.y*d.z;
+        A[5] += d.z*d.z;
+    }
+
+    glm::dvec3 N = smallest_eigenvector(A);
+    return glm::vec3(N.x, N.y, N.z);
+}
+
+
+// points are found back from the positions returned by the tree
+struct PositionHash{
+    size_t operator()(const glm::vec3& X) const {
+        uint32_t b[3];
+        memcpy(b, &X.x, 4);
+        memcpy(b + 1, &X.y, 4);
+        memcpy(b + 2, &X.z, 4);
+        uint64_t h = b[0];
+        h = h * 0x9E3779B97F4A7C15ull ^ b[1];
+        h = h * 0x9E3779B97F4A7C15ull ^ b[2];
+        return size_t(h ^ (h >> 29));
+    }
+};
+
+// edge of the propagation, the most parallel normals first
+struct Propagation{
+    float weight;
+    uint32_t from, to;
+
+    bool operator<(const Propagation& P) const { return weight < P.weight; }
+};
+
+
+void estimate_normals(std::vector<Data>& V, int k){
+
+    C2S_TIMER("normals");
+
+    size_t n = V.size();
+    if(n < 3)
+        return;
+
+    for(std::vector<Data>::iterator it=V.begin(); it!=V.end(); it++)
+        *it = Data((*it).p(), glm::vec3(0.0, 0.0, 0.0));
+
+    Cube init_cube(V);
+    OctTree<Data>* OT = makeTree(V, init_cube);
+
+    std::unordered_map<glm::vec3, uint32_t, PositionHash> first;    // position -> first point there
+    first.reserve(n);
+    for(size_t i=0; i<n; i++)
+        first.insert(std::make_pair(V[i].p(), uint32_t(i)));
+
+    // neighbors of the first point at each position, the point itself left out
+    const uint32_t none = UINT32_MAX;
+    std::vector<uint32_t> knn(n * size_t(k), none);
+    std::vector<glm::vec3> normals(n, glm::vec3(0.0, 0.0, 0.0));
+
+    parallel_for(n, [&](size_t begin, size_t end){
+        std::vector<Data> neighbors;
+        for(size_t i=begin; i<end; i++){
+            if(first.find(V[i].p())->second != i)
+                continue;
+            find_knn(OT, V[i].p(), k + 1, neighbors, init_cube);
+            normals[i] = pca_normal(neighbors);
+            int j = 0;
+            for(std::vector<Data>::const_iterator it=neighbors.begin(); it!=neighbors.end() && j<k; it++){
+                uint32_t other = first.find((*it).p())->second;
+                if(other != i)
+                    knn[i*k + j++] = other;
+            }
+        }
+    });
+
+    delete OT;
+
+    // symmetric graph, as compressed rows
+    std::vector<uint32_t> offsets(n + 1, 0);
+    for(size_t i=0; i<n; i++){
+        for(int j=0; j<k; j++){
+            uint32_t other = knn[i*k + j];
+            if(other == none)
+                continue;
+            offsets[i + 1]++;
+            offsets[other + 1]++;
+        }
+    }
+    for(size_t i=0; i<n; i++)
+        offsets[i + 1] += offsets[i];
+
+    std::vector<uint32_t> edges(offsets[n]);
+    std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+    for(size_t i=0; i<n; i++){
+        for(int j=0; j<k; j++){
+            uint32_t other = knn[i*k + j];
+            if(other == none)
+                continue;
+            edges[fill[i]++] = other;
+            edges[fill[other]++] = uint32_t(i);
+        }
+    }
+    std::vector<uint32_t>().swap(knn);
+
+    // starting points, highest first
+    std::vector<uint32_t> order;
+    for(size_t i=0; i<n; i++){
+        if(first.find(V[i].p())->second == i)
+            order.push_back(uint32_t(i));
+    }
+    std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b){
+        return V[a].p().z > V[b].p().z || (V[a].p().z == V[b].p().z && a < b);
+    });
+
+    std::vector<bool> oriented(n, false);
+    std::priority_queue<Propagation> front;
+
+    for(std::vector<uint32_t>::const_iterator seed=order.begin(); seed!=order.end(); seed++){
+        if(oriented[*seed])
+            continue;
+
+        if(normals[*seed].z < 0.0)
+            normals[*seed] = -normals[*seed];
+        oriented[*seed] = true;
+
+        Propagation start = {0.0, *seed, *seed};
+        front.push(start);
+
+        while(!front.empty()){
+            Propagation P = front.top();
+            front.pop();
+
+            if(P.from != P.to){
+                if(oriented[P.to])
+                    continue;
+                if(scalar_product(normals[P.from], normals[P.to]) < 0.0)
+                    normals[P.to] = -normals[P.to];
+                oriented[P.to] = true;
+            }
+
+            for(uint32_t e=offsets[P.to]; e<offsets[P.to + 1]; e++){
+                uint32_t other = edges[e];
+                if(oriented[other])
+                    continue;
+                Propagation next = {std::fabs(scalar_product(normals[P.to], normals[other])), P.to, other};
+                front.push(next);
+            }
+        }
+    }
+
+    for(size_t i=0; i<n; i++)
+        V[i] = Data(V[i].p(), normals[first.find(V[i].p())->second]);
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <vector>
+
+#include "data.h"
+
+
+
+// Normal estimation for clouds scanned without normals.
+//
+// The normal of each point is the direction of least variance of its k nearest neighbors (PCA of
+// their covariance, solved in closed form), computed on parallel_threads() threads. Normals are then
+// oriented consistently by propagation along a maximum spanning tree of the symmetric kNN graph,
+// edges weighted by |n_i . n_j| so that orientation crosses smooth regions before sharp ones. Each
+// connected part starts from its highest point, oriented upwards, which is outwards on a closed
+// surface. Points at the same position get the same normal.
+
+// overwrite the normals of V
+void estimate_normals(std::vector<Data>& V, int k);
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "stats.h"
+
+
+
+// number of threads used by parallel loops, the number of hardware threads unless set otherwise
+inline int& parallel_threads_setting(){
+    static int nb_threads = 0;
+    return nb_threads;
+}
+
+inline int parallel_threads(){
+    int n = parallel_threads_setting();
+    if(n > 0)
+        return n;
+    return std::max(1, int(std::thread::hardware_concurrency()));
+}
+
+// n <= 0 goes back to the number of hardware threads
+inline void set_parallel_threads(int n){
+    parallel_threads_setting() = n;
+}
+
+// whether the calling thread is running a chunk of a parallel loop
+inline bool& in_parallel_loop(){
+    static thread_local bool inside = false;
+    return inside;
+}
+
+
+// call f(begin, end) on chunks covering [0, n), spread over parallel_threads() threads including the
+// calling one; chunks are handed out on demand so that uneven chunks do not leave threads idle.
+// f must be safe to call concurrently on disjoint chunks. Loops nested in f run on the thread calling
+// them, so that nesting does not multiply the threads
+template<typename F>
+void parallel_for(size_t n, const F& f){
+
+    int nb_threads = in_parallel_loop() ? 1 : int(std::min(size_t(parallel_threads()), n));
+    if(nb_threads <= 1){
+        if(n > 0)
+            f(size_t(0), n);
+        return;
+    }
+
+    size_t grain = std::max(size_t(1), n / (size_t(nb_threads) * 16));
+    std::atomic<size_t> next(0);
+
+#ifdef C2S_MEMTRACK
+    StatsStage* stage = stats_current_stage;    // memory allocated by the workers goes to the caller's stage
+#endif
+
+    auto work = [&](){
+#ifdef C2S_MEMTRACK
+        stats_current_stage = stage;
+#endif
+        in_parallel_loop() = true;
+        for(size_t begin=next.fetch_add(grain); begin<n; begin=next.fetch_add(grain))
+            f(begin, std::min(n, begin + grain));
+        in_parallel_loop() = false;
+    };
+
+    std::vector<std::thread> threads;
+    for(int t=1; t<nb_threads; t++)
+        threads.push_back(std::thread(work));
+    work();
+    for(std::vector<std::thread>::iterator it=threads.begin(); it!=threads.end(); it++)
+        it->join();
+}
+
+
+// sort v with less on parallel_threads() threads: chunks are sorted in parallel, then merged pairwise
+template<typename T, typename Less>
+void parallel_sort(std::vector<T>& v, Less less){
+
+    size_t n = v.size();
+    size_t nb_chunks = std::min(size_t(parallel_threads()), n / 1024 + 1);
+    if(nb_chunks <= 1){
+        std::sort(v.begin(), v.end(), less);
+        return;
+    }
+
+    std::vector<size_t> bounds(nb_chunks + 1);
+    for(size_t c=0; c<=nb_chunks; c++)
+        bounds[c] = n * c / nb_chunks;
+
+    parallel_for(nb_chunks, [&](size_t begin, size_t end){
+        for(size_t c=begin; c<end; c++)
+            std::sort(v.begin() + bounds[c], v.begin() + bounds[c + 1], less);
+    });
+
+    for(size_t width=1; width<nb_chunks; width*=2){
+        size_t nb_merges = (nb_chunks + 2*width - 1) / (2*width);
+        parallel_for(nb_merges, [&](size_t begin, size_t end){
+            for(size_t m=begin; m<end; m++){
+                size_t first = 2*width*m;
+                size_t middle = std::min(first + width, nb_chunks);
+                size_t last = std::min(first + 2*width, nb_chunks);
+                if(middle < last)
+                    std::inplace_merge(v.begin() + bounds[first], v.begin() + bounds[middle], v.begin() + bounds[last], less);
+            }
+        });
+    }
+}
@@ -0,0 +1,171 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+
+// queue holding at most capacity items, so that a fast stage cannot run ahead of a slow one
+template<typename T>
+class BoundedQueue{
+
+    std::mutex mutex;
+    std::condition_variable not_full, not_empty;
+    std::deque<T> items;
+    size_t capacity;
+    bool closed;
+
+public:
+
+    explicit BoundedQueue(size_t c) : capacity(c > 0 ? c : 1), closed(false) {}
+
+    // wait for room, then append item
+    void push(T item){
+        std::unique_lock<std::mutex> lock(mutex);
+        not_full.wait(lock, [&](){ return items.size() < capacity; });
+        items.push_back(std::move(item));
+        not_empty.notify_one();
+    }
+
+    // wait for an item, return false once the queue is closed and empty
+    bool pop(T& item){
+        std::unique_lock<std::mutex> lock(mutex);
+        not_empty.wait(lock, [&](){ return !items.empty() || closed; });
+        if(items.empty())
+            return false;
+        item = std::move(items.front());
+        items.pop_front();
+        not_full.notify_one();
+        return true;
+    }
+
+    // no more pushes, wake up the consumers
+    void close(){
+        std::lock_guard<std::mutex> lock(mutex);
+        closed = true;
+        not_empty.notify_all();
+    }
+};
+
+
+// items run through a chain of stages, each on its own group of threads, with bounded queues between
+// consecutive stages: stage i works on an item while stage i+1 works on an earlier one. Items are
+// created by the threads of the first stage, and dropped after the last one
+template<typename T>
+class Pipeline{
+
+    struct Stage{
+        std::string name;
+        int nb_threads;
+        std::function<bool(T&)> run;
+        std::atomic<uint64_t> busy;    // nanoseconds spent in run, over all threads
+        std::atomic<size_t> items;
+    };
+
+    std::vector<Stage*> stages;
+    size_t capacity;
+    double elapsed;
+
+public:
+
+    explicit Pipeline(size_t queue_capacity) : capacity(queue_capacity), elapsed(0.0) {}
+
+    ~Pipeline(){
+        for(typename std::vector<Stage*>::iterator it=stages.begin(); it!=stages.end(); it++)
+            delete *it;
+    }
+
+    // run(item) processes an item in place, returning false on failure
+    void add_stage(const std::string& name, int nb_threads, const std::function<bool(T&)>& run){
+        Stage* S = new Stage();
+        S->name = name;
+        S->nb_threads = nb_threads > 0 ? nb_threads : 1;
+        S->run = run;
+        S->busy = 0;
+        S->items = 0;
+        stages.push_back(S);
+    }
+
+    // push the n items make(0), ..., make(n-1) through the stages; return false if a stage failed, in
+    // which case the items in flight are dropped without being processed further
+    bool run(size_t n, const std::function<T(size_t)>& make){
+
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+        std::vector<BoundedQueue<T>*> queues;    // queues[s] feeds stage s + 1
+        for(size_t s=0; s+1<stages.size(); s++)
+            queues.push_back(new BoundedQueue<T>(capacity));
+
+        std::atomic<size_t> next(0);
+        std::atomic<bool> failed(false);
+        std::vector<std::atomic<int> > running(stages.size());    // threads of each stage still running
+
+        auto process = [&](Stage* S, T& item){
+            if(failed)
+                return false;
+            std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+            bool ok = S->run(item);
+            S->busy += uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - begin).count());
+            S->items++;
+            if(!ok)
+                failed = true;
+            return ok;
+        };
+
+        auto work = [&](size_t s){
+            Stage* S = stages[s];
+            T item;
+            while(true){
+                if(s == 0){
+                    size_t i = next.fetch_add(1);
+                    if(i >= n || failed)
+                        break;
+                    item = make(i);
+                }
+                else if(!queues[s-1]->pop(item))
+                    break;
+
+                if(process(S, item) && s+1 < stages.size())
+                    queues[s]->push(std::move(item));
+            }
+            // the last thread of a stage closes the queue it feeds
+            if(--running[s] == 0 && s+1 < stages.size())
+                queues[s]->close();
+        };
+
+        std::vector<std::thread> threads;
+        for(size_t s=0; s<stages.size(); s++)
+            running[s] = stages[s]->nb_threads;
+        for(size_t s=0; s<stages.size(); s++){
+            for(int t=0; t<stages[s]->nb_threads; t++)
+                threads.push_back(std::thread(work, s));
+        }
+        for(std::vector<std::thread>::iterator it=threads.begin(); it!=threads.end(); it++)
+            it->join();
+
+        for(typename std::vector<BoundedQueue<T>*>::iterator it=queues.begin(); it!=queues.end(); it++)
+            delete *it;
+
+        elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        return !failed;
+    }
+
+    // one line per stage: items processed, busy time and utilization of its threads over the last run
+    void report(FILE * out) const{
+        for(typename std::vector<Stage*>::const_iterator it=stages.begin(); it!=stages.end(); it++){
+            double busy = double((*it)->busy) * 1e-9;
+            fprintf(out, "stage %-10s %d thread(s), %lu items, busy %.3fs, utilization %.0f%%\n", (*it)->name.c_str(),
+                (*it)->nb_threads, (unsigned long)(*it)->items, busy,
+                elapsed > 0.0 ? 100.0 * busy / (elapsed * double((*it)->nb_threads)) : 0.0);
+        }
+        fprintf(out, "pipeline %.3fs\n", elapsed);
+    }
+};
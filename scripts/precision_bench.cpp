@@ -0,0 +1,160 @@
+// Throughput and accuracy of the float and double reconstruction paths
+//
+// usage: PrecisionBenchmark [--sizes n,n,...] [--extents e,e,...] [--threads n]
+//
+// A large scene is simulated by a sphere of radius 0.4/e at the far corner of the unit cube: the larger the
+// extent e, the smaller the grid step relative to the coordinates. The lattice is anchored at the corner of
+// the box of side 1/e around the sphere, so that keys stay in range. The sphere is sampled in double, the
+// float path gets the same points rounded. Both paths evaluate the field on the same cells, then extract
+// the mesh. Results go to stdout as csv, one line per scalar type, size and extent:
+//
+//   scalar,extent,points,vertices,tree_s,field_s,extract_s,vertices_per_s,mean_error,max_error,triangles
+//
+// where vertices counts the lattice vertices evaluated, and the errors are the distances between the field
+// and the exact signed distance to the sphere at the exact vertex positions, over the vertices with support,
+// in grid steps. The parameters are scaled with the density of the sphere (density_params in bench_utils.h).
+
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "data.h"
+#include "rimls.h"
+#include "lattice.h"
+#include "extract.h"
+#include "synthetic.h"
+#include "bench_utils.h"
+#include "parallel.h"
+
+
+struct PrecisionResult{
+    size_t vertices;
+    double tree, field, extract;
+    double mean_error, max_error;
+    size_t triangles;
+};
+
+
+// reconstruct at precision S from the points of exact, on the lattice of given origin and over the cells
+// (packed keys) shared by both paths; errors are measured against the sphere of center c and radius r
+template<typename S>
+static void reconstruct(const std::vector<DataD>& exact, const LatticeD& exact_lattice, const std::vector<uint64_t>& cells, 
+    const RimlsParams& params, const glm::dvec3& c, double r, PrecisionResult& result){
+
+    std::vector<BasicData<S> > V;
+    V.reserve(exact.size());
+    for(std::vector<DataD>::const_iterator it=exact.begin(); it!=exact.end(); it++)
+        V.push_back(BasicData<S>(*it));
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    BasicCube<S> init_cube(V);
+    OctTree<BasicData<S> >* OT = makeTree(V, init_cube);
+    result.tree = seconds_since(start);
+
+    BasicLattice<S> L(exact_lattice);
+    BasicScalarField<S> field;
+
+    start = std::chrono::steady_clock::now();
+    rimls_lattice(cells, L, OT, init_cube, params, field);
+    result.field = seconds_since(start);
+    result.vertices = field.size();
+
+    start = std::chrono::steady_clock::now();
+    Mesh mesh;
+    extract_mesh(L, cells, field, 0.0, mesh);
+    result.extract = seconds_since(start);
+    result.triangles = mesh.nb_triangles();
+
+    // errors against the exact vertex positions, which the float lattice may not represent
+    double sum = 0.0;
+    size_t supported = 0;
+    result.max_error = 0.0;
+    for(typename BasicScalarField<S>::const_iterator it=field.begin(); it!=field.end(); it++){
+        if(std::isnan(it->second.value))
+            continue;
+        glm::dvec3 X = exact_lattice.vertex(unpack_key(it->first));
+        double error = std::fabs(double(it->second.value) - (euclidean_distance(X, c) - r)) / double(params.grid_step);
+        sum += error;
+        result.max_error = std::max(result.max_error, error);
+        supported++;
+    }
+    result.mean_error = supported ? sum / double(supported) : 0.0;
+
+    delete OT;
+}
+
+
+int main(int argc, char **argv)
+{
+    std::vector<double> sizes;
+    std::vector<double> extents;
+
+    for(int i=1; i<argc; i++){
+        bool has_value = i+1 < argc;
+
+        if(strcmp(argv[i], "--sizes") == 0 && has_value)
+            split_list(argv[++i], sizes);
+        else if(strcmp(argv[i], "--extents") == 0 && has_value)
+            split_list(argv[++i], extents);
+        else if(strcmp(argv[i], "--threads") == 0 && has_value)
+            set_parallel_threads(atoi(argv[++i]));
+        else{
+            printf("usage: %s [--sizes n,n,...] [--extents e,e,...] [--threads n]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    if(sizes.empty())
+        sizes.push_back(2e4);
+    if(extents.empty()){
+        const double defaults[5] = {1.0, 1e2, 1e3, 1e4, 1e5};
+        extents.assign(defaults, defaults + 5);
+    }
+
+    printf("scalar,extent,points,vertices,tree_s,field_s,extract_s,vertices_per_s,mean_error,max_error,triangles\n");
+
+    for(std::vector<double>::const_iterator n=sizes.begin(); n!=sizes.end(); n++){
+
+        std::vector<Data> unit;
+        sphere_cloud(size_t(*n), unit);
+
+        for(std::vector<double>::const_iterator e=extents.begin(); e!=extents.end(); e++){
+
+            double r = 0.4 / *e;
+            glm::dvec3 c(1.0 - 0.5 / *e, 1.0 - 0.5 / *e, 1.0 - 0.5 / *e);
+
+            std::vector<DataD> exact;
+            exact.reserve(unit.size());
+            for(std::vector<Data>::const_iterator it=unit.begin(); it!=unit.end(); it++){
+                glm::dvec3 N(it->n());
+                exact.push_back(DataD(c + r*N, N));
+            }
+
+            // on an object of size 1/e
+            RimlsParams params = density_params(exact.size(), 1.0 / *e);
+
+            LatticeD L(c - glm::dvec3(0.5 / *e, 0.5 / *e, 0.5 / *e), double(params.grid_step));
+            std::vector<uint64_t> cells;
+            const int bound = lattice_key_bias - 1;
+            activate_cells(exact, L, 1, LatticeKey(-bound, -bound, -bound), LatticeKey(bound, bound, bound), cells);
+
+            for(int s=0; s<2; s++){
+                PrecisionResult R;
+                if(s == 0)
+                    reconstruct<float>(exact, L, cells, params, c, r, R);
+                else
+                    reconstruct<double>(exact, L, cells, params, c, r, R);
+
+                printf("%s,%g,%lu,%lu,%.4f,%.4f,%.4f,%.1f,%.4g,%.4g,%lu\n", s == 0 ? "float" : "double", *e,
+                    (unsigned long)exact.size(), (unsigned long)R.vertices, R.tree, R.field, R.extract,
+                    double(R.vertices) / R.field, R.mean_error, R.max_error, (unsigned long)R.triangles);
+                fflush(stdout);
+            }
+        }
+    }
+
+    return 0;
+}
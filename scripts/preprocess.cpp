@@ -0,0 +1,201 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <unordered_map>
+
+#include "preprocess.h"
+#include "lattice.h"
+#include "parallel.h"
+#include "stats.h"
+
+
+// voxel indices are packed on 21 bits per axis
+static const int voxel_bits = 21;
+
+
+bool voxel_downsample(std::vector<Data>& V, float voxel){
+
+    C2S_TIMER("downsample");
+
+    if(V.empty())
+        return true;
+
+    glm::vec3 lo = V[0].p();
+    glm::vec3 hi = V[0].p();
+    for(std::vector<Data>::const_iterator it=V.begin(); it!=V.end(); it++){
+        lo = glm::min(lo, (*it).p());
+        hi = glm::max(hi, (*it).p());
+    }
+
+    for(int a=0; a<3; a++){
+        if((hi[a] - lo[a]) / voxel >= float(1 << voxel_bits)){
+            printf("ERROR: voxel size %g too small for the extent of the cloud\n", voxel);
+            return false;
+        }
+    }
+
+    // (voxel, point) pairs, sorted so that the points of a voxel are contiguous
+    std::vector<std::pair<uint64_t, uint32_t> > keys(V.size());
+    parallel_for(V.size(), [&](size_t begin, size_t end){
+        const uint64_t mask = (uint64_t(1) << voxel_bits) - 1;
+        for(size_t i=begin; i<end; i++){
+            glm::vec3 X = (V[i].p() - lo) / voxel;
+            uint64_t key = 0;
+            for(int a=2; a>=0; a--)
+                key = (key << voxel_bits) | (uint64_t(std::floor(X[a])) & mask);
+            keys[i] = std::make_pair(key, uint32_t(i));
+        }
+    });
+
+    parallel_sort(keys, [](const std::pair<uint64_t, uint32_t>& A, const std::pair<uint64_t, uint32_t>& B){
+        return A < B;
+    });
+
+    std::vector<size_t> starts;
+    for(size_t i=0; i<keys.size(); i++){
+        if(i == 0 || keys[i].first != keys[i-1].first)
+            starts.push_back(i);
+    }
+    starts.push_back(keys.size());
+
+    std::vector<Data> merged(starts.size() - 1);
+    parallel_for(merged.size(), [&](size_t begin, size_t end){
+        for(size_t m=begin; m<end; m++){
+            glm::dvec3 sum_p(0.0, 0.0, 0.0);
+            glm::vec3 sum_n(0.0, 0.0, 0.0);
+            for(size_t i=starts[m]; i<starts[m+1]; i++){
+                const Data& D = V[keys[i].second];
+                sum_p += glm::dvec3(D.p().x, D.p().y, D.p().z);
+                sum_n += D.n();
+            }
+            sum_p = sum_p / double(starts[m+1] - starts[m]);
+
+            // opposite normals cancel out, keep the first one then
+            float norm = euclidean_norm(sum_n);
+            glm::vec3 N = (norm > 1e-6) ? sum_n / norm : V[keys[starts[m]].second].n();
+            merged[m] = Data(glm::vec3(sum_p.x, sum_p.y, sum_p.z), N);
+        }
+    });
+
+    V.swap(merged);
+    return true;
+}
+
+
+struct LatticeKeyHash{
+    size_t operator()(const LatticeKey& K) const {
+        uint64_t h = uint32_t(K.i);
+        h = h * 0x9E3779B97F4A7C15ull ^ uint32_t(K.j);
+        h = h * 0x9E3779B97F4A7C15ull ^ uint32_t(K.k);
+        return size_t(h ^ (h >> 29));
+    }
+};
+
+size_t merge_duplicates(std::vector<Data>& V, float epsilon){
+
+    C2S_TIMER("dedup");
+
+    if(V.empty() || epsilon <= 0.0)
+        return 0;
+
+    // cells of side epsilon: a point closer than epsilon lies in one of the 27 cells around
+    Lattice L(V[0].p(), epsilon);
+    for(std::vector<Data>::const_iterator it=V.begin(); it!=V.end(); it++)
+        L.origin = glm::min(L.origin, (*it).p());
+
+    std::unordered_map<LatticeKey, std::vector<uint32_t>, LatticeKeyHash> cells;    // cell -> points kept
+    std::vector<Data> kept;
+    std::vector<glm::vec3> normals;    // sums of the normals merged in each point kept
+
+    for(std::vector<Data>::const_iterator it=V.begin(); it!=V.end(); it++){
+
+        LatticeKey C = L.cell((*it).p());
+        int nearest = -1;
+        float best = epsilon;
+
+        for(int k=C.k-1; k<=C.k+1; k++)
+            for(int j=C.j-1; j<=C.j+1; j++)
+                for(int i=C.i-1; i<=C.i+1; i++){
+                    std::unordered_map<LatticeKey, std::vector<uint32_t>, LatticeKeyHash>::const_iterator found =
+                        cells.find(LatticeKey(i, j, k));
+                    if(found == cells.end())
+                        continue;
+                    for(std::vector<uint32_t>::const_iterator p=found->second.begin(); p!=found->second.end(); p++){
+                        float d = (*it).dist(kept[*p]);
+                        if(d < best){
+                            best = d;
+                            nearest = int(*p);
+                        }
+                    }
+                }
+
+        if(nearest >= 0){
+            normals[nearest] += (*it).n();
+            continue;
+        }
+
+        cells[C].push_back(uint32_t(kept.size()));
+        kept.push_back(*it);
+        normals.push_back((*it).n());
+    }
+
+    size_t merged = V.size() - kept.size();
+
+    for(size_t i=0; i<kept.size(); i++){
+        float norm = euclidean_norm(normals[i]);
+        if(norm > 1e-6)
+            kept[i] = Data(kept[i].p(), normals[i] / norm);
+    }
+
+    V.swap(kept);
+    return merged;
+}
+
+
+size_t remove_outliers(std::vector<Data>& V, int k, float sigma){
+
+    C2S_TIMER("outliers");
+
+    if(V.size() < 2 || k <= 0)
+        return 0;
+
+    Cube init_cube(V);
+    OctTree<Data>* OT = makeTree(V, init_cube);
+
+    std::vector<float> distances(V.size());
+    parallel_for(V.size(), [&](size_t begin, size_t end){
+        std::vector<Data> neighbors;
+        for(size_t i=begin; i<end; i++){
+            // the point itself comes first
+            find_knn(OT, V[i].p(), k + 1, neighbors, init_cube);
+            float sum = 0.0;
+            for(size_t j=1; j<neighbors.size(); j++)
+                sum += V[i].dist(neighbors[j]);
+            distances[i] = (neighbors.size() > 1) ? sum / float(neighbors.size() - 1) : 0.0;
+        }
+    });
+
+    delete OT;
+
+    double mean = 0.0;
+    for(std::vector<float>::const_iterator it=distances.begin(); it!=distances.end(); it++)
+        mean += *it;
+    mean /= double(distances.size());
+
+    double variance = 0.0;
+    for(std::vector<float>::const_iterator it=distances.begin(); it!=distances.end(); it++)
+        variance += (*it - mean) * (*it - mean);
+    variance /= double(distances.size());
+
+    float threshold = float(mean + sigma * std::sqrt(variance));
+
+    size_t kept = 0;
+    for(size_t i=0; i<V.size(); i++){
+        if(distances[i] <= threshold)
+            V[kept++] = V[i];
+    }
+
+    size_t removed = V.size() - kept;
+    V.resize(kept);
+    return removed;
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <vector>
+
+#include "data.h"
+
+
+
+// Preprocessing of raw scans ahead of the reconstruction.
+
+// merge the points of V falling in the same voxel (cubes of side voxel, aligned on the lowest corner of
+// the cloud) into one point at their centroid, with their average normal renormalized; points come out
+// in voxel order, whatever the number of threads. Return false, leaving V as is, if the cloud spans
+// more than 2^21 voxels along an axis
+bool voxel_downsample(std::vector<Data>& V, float voxel);
+
+// merge each point of V closer than epsilon to an earlier point kept into that point, whose normal becomes
+// the renormalized average of the normals merged; nearly coincident points from overlapping passes would
+// otherwise make the tree subdivide until they separate. Points are visited in order, the first of a
+// cluster stays where it is. Return the number of points merged
+size_t merge_duplicates(std::vector<Data>& V, float epsilon);
+
+// statistical outlier removal: drop the points of V whose mean distance to their k nearest neighbors is
+// more than sigma standard deviations above the mean over the cloud. Such stray points have no neighbor
+// within radius and send rimls_regular searching the whole tree. Distances are computed in parallel, the
+// points kept stay in order. Return the number of points removed
+size_t remove_outliers(std::vector<Data>& V, int k, float sigma);
@@ -0,0 +1,59 @@
+#include <algorithm>
+
+#include "progressive.h"
+
+
+void rimls_progressive(const std::vector<Data>& V, OctTree<Data>* OT, const Cube& init_cube, const RimlsParams& params,
+    int levels, int dilation, float target, const LevelCallback& publish){
+
+    Lattice L(glm::vec3(0.0, 0.0, 0.0), params.grid_step * float(1 << (levels - 1)));
+
+    const int bound = lattice_key_bias - 1;
+    std::vector<uint64_t> cells;
+    activate_cells(V, L, dilation, LatticeKey(-bound, -bound, -bound), LatticeKey(bound, bound, bound), cells);
+
+    ScalarField field;
+
+    for(int level=0; level<levels; level++){
+
+        rimls_lattice(cells, L, OT, init_cube, params, field);
+
+        Mesh mesh;
+        extract_mesh(L, cells, field, target, mesh);
+        publish(level, L, mesh);
+
+        if(level == levels - 1)
+            break;
+
+        // halving the step is exact, vertex K of this level is vertex 2K of the next one
+        Lattice F(L.origin, L.step / float(2.0));
+
+        ScalarField kept;
+        for(ScalarField::const_iterator it=field.begin(); it!=field.end(); it++){
+            LatticeKey K = unpack_key(it->first);
+            kept[pack_key(LatticeKey(2*K.i, 2*K.j, 2*K.k))] = it->second;
+        }
+
+        EdgeVertex edges[12];
+        int triangles[15];
+        std::vector<uint64_t> children;
+
+        for(std::vector<uint64_t>::const_iterator it=cells.begin(); it!=cells.end(); it++){
+            if(march_cell(L, *it, field, target, edges, triangles) == 0)
+                continue;
+
+            LatticeKey C = unpack_key(*it);
+            for(int k=2*C.k-1; k<=2*C.k+2; k++)
+                for(int j=2*C.j-1; j<=2*C.j+2; j++)
+                    for(int i=2*C.i-1; i<=2*C.i+2; i++)
+                        children.push_back(pack_key(LatticeKey(i, j, k)));
+        }
+
+        std::sort(children.begin(), children.end());
+        children.erase(std::unique(children.begin(), children.end()), children.end());
+
+        L = F;
+        field.swap(kept);
+        cells.swap(children);
+    }
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <functional>
+#include <vector>
+
+#include "rimls.h"
+#include "extract.h"
+
+
+
+// receives the surface of each level as soon as it is extracted, level 0 being the coarsest
+typedef std::function<void(int level, const Lattice& L, const Mesh& mesh)> LevelCallback;
+
+// coarse to fine reconstruction: the first level uses a step of params.grid_step * 2^(levels-1) on the
+// cells activated by V, each next level halves the step and only evaluates the children of the cells
+// crossed by the previous surface (and their direct neighbors). Vertices shared with the previous level
+// are not evaluated again. The last level has params.grid_step
+void rimls_progressive(const std::vector<Data>& V, OctTree<Data>* OT, const Cube& init_cube, const RimlsParams& params,
+    int levels, int dilation, float target, const LevelCallback& publish);
@@ -1,105 +1,190 @@
+#include <algorithm>
+#include <cmath>
+
 #include "rimls.h"
+#include "stats.h"
+#include "parallel.h"
 
-float phi(float t, float h){
+template<typename S>
+S phi(S t, S h){
 	return pow(1.0 - t / pow(h, 2), 4);
 };
 
-float dphi(float t, float h){
+template<typename S>
+S dphi(S t, S h){
 	return -4.0 * pow(1.0 - t / pow(h, 2), 3) / pow(h, 2);
 };
 
-float rimls_step(const glm::vec3& point, const std::vector<Data>& neighbors, float h, float sigma_r, float sigma_n, int max_iter, int& n){
+template<typename S>
+S rimls_step(const glm::tvec3<S>& point, const BasicData<S>* neighbors, int n, S h, S sigma_r, S sigma_n, int max_iter, 
+	glm::tvec3<S>& grad_f){
 
-	float f;
-	glm::vec3 grad_f;
+	C2S_TIMER("rimls_step");
 
-	bool print = false;
+	S f;
 
 	for(int k=0; k<max_iter; k++){
 
-		float sum_w = 0.0;
-		float sum_f = 0.0;
-		float alpha;
+		S sum_w = 0.0;
+		S sum_f = 0.0;
+		S alpha;
 
 
-		glm::vec3 sum_n(0.0, 0.0, 0.0);
-		glm::vec3 sum_gw(0.0, 0.0, 0.0);
-		glm::vec3 sum_gf(0.0, 0.0, 0.0);
+		glm::tvec3<S> sum_n(0.0, 0.0, 0.0);
+		glm::tvec3<S> sum_gw(0.0, 0.0, 0.0);
+		glm::tvec3<S> sum_gf(0.0, 0.0, 0.0);
 
-		for(std::vector<Data>::const_iterator it=neighbors.begin(); it!=neighbors.end(); it++){
+		for(const BasicData<S>* it=neighbors; it!=neighbors+n; it++){
 
-			glm::vec3 dx = point - (*it).p();
-			float fx = scalar_product(dx, (*it).n());
+			glm::tvec3<S> dx = point - (*it).p();
+			S fx = scalar_product(dx, (*it).n());
 			alpha = 1.0;
 			if(k>0)
 				alpha = std::exp(-pow((fx-f)/sigma_r, 2)) * std::exp(-pow(euclidean_norm((*it).n()-grad_f)/sigma_n, 2));
 
-			float w = alpha * phi(pow(euclidean_norm(point-(*it).p()), 2), h);
-			glm::vec3 grad_w = alpha * 2 * dx * dphi(pow(euclidean_norm(point-(*it).p()), 2), h);
+			S w = alpha * phi<S>(pow(euclidean_norm(point-(*it).p()), 2), h);
+			glm::tvec3<S> grad_w = alpha * 2 * dx * dphi<S>(pow(euclidean_norm(point-(*it).p()), 2), h);
 
 			sum_w += w;
 			sum_gw += grad_w;
 			sum_f += w * fx;
 			sum_gf += grad_w * fx;
 			sum_n += w * (*it).n();
+		}
+
+		f = sum_f / sum_w; 
+		grad_f = (sum_gf - f*sum_gw + sum_n) / sum_w;
+	}
 
-			//std::cout<< k << " " << alpha << std::endl;
-			
-		
+	C2S_COUNT(RIMLS_ITERATIONS, max_iter);
+	if(std::isnan(f))
+		C2S_COUNT(NAN_RESULTS, 1);
+
+	return f;
+}
+
+float rimls_step(const glm::vec3& point, const std::vector<Data>& neighbors, float h, float sigma_r, float sigma_n, int max_iter, 
+	glm::vec3& grad_f){
+
+	return rimls_step<float>(point, neighbors.data(), int(neighbors.size()), h, sigma_r, sigma_n, max_iter, grad_f);
+}
+
+float rimls_step(const glm::vec3& point, const std::vector<Data>& neighbors, float h, float sigma_r, float sigma_n, int max_iter){
+
+	glm::vec3 grad_f;
+	return rimls_step<float>(point, neighbors.data(), int(neighbors.size()), h, sigma_r, sigma_n, max_iter, grad_f);
+}
+
+// rimls_step for at most N neighbors and ITER iterations: the weights, which do not change between
+// iterations, are computed once into arrays on the stack, and the loops have constant trip counts so
+// that the compiler unrolls them. Slots past n get a null weight, leaving the sums as in rimls_step
+template<typename S, int N, int ITER>
+static S rimls_step_fixed(const glm::tvec3<S>& point, const BasicData<S>* neighbors, int n, S h, S sigma_r, S sigma_n, 
+	int /*max_iter*/, glm::tvec3<S>& grad_f){
+
+	C2S_TIMER("rimls_step");
+
+	glm::tvec3<S> dx[N];
+	glm::tvec3<S> nx[N];
+	S fx[N];
+	S phix[N];
+	S dphix[N];
+
+	for(int i=0; i<N; i++){
+		if(i < n){
+			dx[i] = point - neighbors[i].p();
+			nx[i] = neighbors[i].n();
+			fx[i] = scalar_product(dx[i], nx[i]);
+			S t = pow(euclidean_norm(point-neighbors[i].p()), 2);
+			phix[i] = phi<S>(t, h);
+			dphix[i] = dphi<S>(t, h);
+		}
+		else{
+			dx[i] = glm::tvec3<S>(0.0, 0.0, 0.0);
+			nx[i] = glm::tvec3<S>(0.0, 0.0, 0.0);
+			fx[i] = 0.0;
+			phix[i] = 0.0;
+			dphix[i] = 0.0;
 		}
+	}
+
+	S f;
+
+	for(int k=0; k<ITER; k++){
+
+		S sum_w = 0.0;
+		S sum_f = 0.0;
+
+		glm::tvec3<S> sum_n(0.0, 0.0, 0.0);
+		glm::tvec3<S> sum_gw(0.0, 0.0, 0.0);
+		glm::tvec3<S> sum_gf(0.0, 0.0, 0.0);
+
+		for(int i=0; i<N; i++){
 
-		if(print){
+			S alpha = 1.0;
+			if(k>0)
+				alpha = std::exp(-pow((fx[i]-f)/sigma_r, 2)) * std::exp(-pow(euclidean_norm(nx[i]-grad_f)/sigma_n, 2));
+
+			S w = alpha * phix[i];
+			glm::tvec3<S> grad_w = alpha * 2 * dx[i] * dphix[i];
 
-			// for(std::vector<Data>::const_iterator it=neighbors.begin(); it!=neighbors.end(); it++){
-			// 	std::cout << (*it).p().x << " " << (*it).p().y << " " << (*it).p().z << std::endl;
-			// }
-			//std::cout << "neighbors " << neighbors.size() << " alpha " << alpha << std::endl;
+			sum_w += w;
+			sum_gw += grad_w;
+			sum_f += w * fx[i];
+			sum_gf += grad_w * fx[i];
+			sum_n += w * nx[i];
 		}
 
 		f = sum_f / sum_w; 
 		grad_f = (sum_gf - f*sum_gw + sum_n) / sum_w;
+	}
 
+	C2S_COUNT(RIMLS_ITERATIONS, ITER);
+	if(std::isnan(f))
+		C2S_COUNT(NAN_RESULTS, 1);
 
-		if(std::isnan(f)){
-			if(print==false){
-				n++;
-				std::cout << "n " << n << " k " << k << " sum_w " << sum_w << std::endl;
-
-				if(k==0){
-					std::cout << point.x << " " << point.y << " " << point.z << std::endl;
-					for(std::vector<Data>::const_iterator it=neighbors.begin(); it!=neighbors.end(); it++){
-						float what = phi(pow(euclidean_norm(point-(*it).p()), 2), h);
-						std::cout << (*it).p().x << " " << (*it).p().y << " " << (*it).p().z << " " << "phi: " << what << std::endl;
-					}
-					printf("\n");
-				}
-			}
-		 	print = true;
-		// 	printf("NAN\n");
-		//    	//std::cout << "NAN alpha: " << alpha << " k " << k << std::endl; //" dist " << euclidean_distance(neighbors[0].p(), point) << std::endl; 
-		    }
+	return f;
+}
 
-		    
-	
-		// printf("NAN !!");
-		// std::cout<< euclidean_distance(neighbors[0].p(), point) << std::endl;
-		// printf("\n");
-		// }
+template<typename S, int N>
+static BasicRimlsKernel<S> rimls_kernel_iter(int max_iter){
+	switch(max_iter){
+		case 1: return rimls_step_fixed<S, N, 1>;
+		case 2: return rimls_step_fixed<S, N, 2>;
+		case 3: return rimls_step_fixed<S, N, 3>;
+		case 4: return rimls_step_fixed<S, N, 4>;
+		case 5: return rimls_step_fixed<S, N, 5>;
+	}
+	return rimls_step<S>;
+}
 
-	
+template<typename S>
+BasicRimlsKernel<S> rimls_kernel(int max_neighbors, int max_iter){
+	switch(max_neighbors){
+		case 8: return rimls_kernel_iter<S, 8>(max_iter);
+		case 10: return rimls_kernel_iter<S, 10>(max_iter);
+		case 16: return rimls_kernel_iter<S, 16>(max_iter);
+		case 20: return rimls_kernel_iter<S, 20>(max_iter);
 	}
+	return rimls_step<S>;
+}
 
-	
-	// for(std::vector<Data>::const_iterator it=neighbors.begin(); it!=neighbors.end(); it++){
-	// 			std::cout << (*it).p().x << " " << (*it).p().y << " " << (*it).p().z << std::endl;
-	// 		}
-	//printf("\n");
-	//printf("\n");
-	return f;
+// nearest points of X within fallback_radius, at most max_neighbors, when radius holds less than 2 points;
+// unlike a search with a larger radius, its cost does not grow with the distance to the cloud
+template<typename S>
+static void fallback_neighbors(const BasicData<S>& X, const BasicNeighborIndex<S>& index, int max_neighbors, S fallback_radius, 
+	std::vector<BasicData<S> >& neighbors){
+
+	C2S_TIMER("fallback");
+	C2S_COUNT(FALLBACK_SEARCHES, 1);
+
+	index.find_knn(X.p(), max_neighbors, neighbors);
+	while(!neighbors.empty() && X.dist(neighbors.back()) > fallback_radius)
+		neighbors.pop_back();
 }
 
-Cube rimls_regular(const Data& D, OctTree<Data>* OT, Cube init_cube, float radius, float grid_step, float sigma_r, float sigma_n, int max_neighbors, 
-	int max_iter, int& n){
+static Cube rimls_regular(const Data& D, OctTree<Data>* OT, Cube init_cube, float radius, float grid_step, float sigma_r, float sigma_n, 
+	int max_neighbors, int max_iter, Fallback fallback, float fallback_radius, RimlsKernel kernel){
 	
 	glm::vec3 origin = D.p() - grid_step*float(0.5)*glm::vec3(1.0, 1.0, 1.0);  // init cube centered on data point
 	Cube cube(origin, grid_step);
@@ -110,106 +195,277 @@ Cube rimls_regular(const Data& D, OctTree<Data>* OT, Cube init_cube, float radiu
 		int counter = 0;
 		std::vector<Data> neighbors;
 
-		find_neighbors(OT, point, radius, neighbors, init_cube, true, counter);
+		{
+			C2S_TIMER("neighbors");
 
+			float r = radius;
+			find_neighbors(OT, point, r, neighbors, init_cube, true, counter);
+			C2S_COUNT(NEIGHBOR_QUERIES, 1);
+			C2S_COUNT(NODES_VISITED, counter);
+			C2S_COUNT(NEIGHBORS_FOUND, neighbors.size());
+		}
 
+		// must be at least 2 neighbors to avoid underflow
+		if(neighbors.size() < 2 && fallback == FALLBACK_KNN)
+			fallback_neighbors(point, OctTreeIndex(OT, init_cube), max_neighbors, fallback_radius, neighbors);
 
 		if(neighbors.size() < 2){
-			printf("radius too small\n");
-			float max_radius = sqrt(3.0)*init_cube.scale;
-			find_neighbors(OT, point, max_radius, neighbors, init_cube, true, counter);; // must be at least 2 neighbors to avoid underflow, 
-			                                                                                  // could also skip point ?
+			C2S_COUNT(UNSUPPORTED_VERTICES, 1);
+			cube.add_field(k, NAN);
+			continue;
 		}
 
-		else{ printf("radius ok\n");}
+		// the last max_neighbors neighbors found, hx the sum of their distances to the vertex
+		std::reverse(neighbors.begin(), neighbors.end());
+		float hx = 0.0;
+		int counterx = 0;
+		for(; counterx<int(neighbors.size()) && counterx<max_neighbors; counterx++)
+			hx += point.dist(neighbors[counterx]);
 
-	
-		float h = 0.0;
-		counter = 0;
+		glm::vec3 grad_f;
+		cube.add_field(k, kernel(point.p(), neighbors.data(), counterx, hx, sigma_r, sigma_n, max_iter, grad_f));
+	}
 
-		std::vector<Data> nearest_neighbors;
+	return cube;
+}
 
+Cube rimls_regular(const Data& D, OctTree<Data>* OT, Cube init_cube, float radius, float grid_step, float sigma_r, float sigma_n, int max_neighbors, 
+	int max_iter, Fallback fallback, float fallback_radius){
 
-		// for(std::vector<Data>::const_iterator it=neighbors.end(); it!=neighbors.begin(); it--){
-		// 	h += point.dist(*it);
-		// 	counter++;
-		// 	nearest_neighbors.push_back(*it);
+	return rimls_regular(D, OT, init_cube, radius, grid_step, sigma_r, sigma_n, max_neighbors, max_iter, fallback, fallback_radius, 
+		rimls_kernel<float>(max_neighbors, max_iter));
+}
 
-		// 	if(counter >= max_neighbors)
-		// 		break;
-		// }
+void rimls(const std::vector<Data>& V, std::vector<Cube>& grid, float radius, float grid_step, float sigma_r, float sigma_n, int max_neighbors, 
+	int max_iter, Fallback fallback, float fallback_radius){
 
+	C2S_TIMER("rimls");
 
+	Cube init_cube(V);
+	OctTree<Data>* OT = makeTree(V, init_cube);
+	RimlsKernel kernel = rimls_kernel<float>(max_neighbors, max_iter);
 
+	for(std::vector<Data>::const_iterator it=V.begin(); it!=V.end(); it++){
+		grid.push_back(rimls_regular(*it, OT, init_cube, radius, grid_step, sigma_r, sigma_n, max_neighbors, max_iter, fallback, 
+			fallback_radius, kernel));
+	}
 
-		float hx = 0.0;
-		float counterx = 0;
-		int l = neighbors.size();
+	delete OT;
+};
 
-		std::vector<Data> testx;
+// orders neighbors of X by distance, ties broken on coordinates so that the order does not
+// depend on the order in which the tree returned them
+template<typename S>
+struct CloserTo{
+
+	glm::tvec3<S> X;
+
+	CloserTo(const glm::tvec3<S>& P) : X(P) {}
+
+	bool operator()(const BasicData<S>& A, const BasicData<S>& B) const {
+		glm::tvec3<S> da = A.p() - X;
+		glm::tvec3<S> db = B.p() - X;
+		S a = scalar_product(da, da);
+		S b = scalar_product(db, db);
+		if(a != b)
+			return a < b;
+		for(int i=0; i<3; i++){
+			if(A.p()[i] != B.p()[i])
+				return A.p()[i] < B.p()[i];
+		}
+		for(int i=0; i<3; i++){
+			if(A.n()[i] != B.n()[i])
+				return A.n()[i] < B.n()[i];
+		}
+		return false;
+	}
+};
 
-		for(int i=0; i<l; i++){
+template<typename S>
+bool rimls_support(const glm::tvec3<S>& X, const BasicNeighborIndex<S>& index, const RimlsParams& params, 
+	std::vector<BasicData<S> >& neighbors, S& h){
 
-			Data pt(neighbors[l-1-i]);
-			hx += point.dist(pt);
-			testx.push_back(pt);
-			counterx ++;
+	C2S_TIMER("neighbors");
 
-			if(counterx >= max_neighbors)
-				break;
+	BasicData<S> point(X, glm::tvec3<S>(0.0, 0.0, 0.0));
+	S r = params.radius;
+	int counter = 0;
+	neighbors.clear();
 
+	index.find_neighbors(point, r, neighbors, counter);
+	C2S_COUNT(NEIGHBOR_QUERIES, 1);
+	C2S_COUNT(NODES_VISITED, counter);
+	C2S_COUNT(NEIGHBORS_FOUND, neighbors.size());
 
-		}
-		//////////////////////////////////////
-			// float maxi = 0.0;
-   //      	float mini = 1.0;
+	if(neighbors.size() < 2 && params.fallback == FALLBACK_KNN)
+		fallback_neighbors(point, index, params.max_neighbors, S(params.fallback_radius), neighbors);
+
+	if(neighbors.size() < 2){
+		C2S_COUNT(UNSUPPORTED_VERTICES, 1);
+		return false;
+	}
+
+	if(int(neighbors.size()) > params.max_neighbors){
+		std::partial_sort(neighbors.begin(), neighbors.begin() + params.max_neighbors, neighbors.end(), CloserTo<S>(X));
+		neighbors.resize(params.max_neighbors);
+	}
+	else
+		std::sort(neighbors.begin(), neighbors.end(), CloserTo<S>(X));
 
-		 //    for(std::vector<Data>::const_iterator it=neighbors.begin(); it !=neighbors.end(); it++){
+	h = 0.0;    // same support size as rimls_regular: sum of distances to the selected neighbors
+	for(typename std::vector<BasicData<S> >::const_iterator it=neighbors.begin(); it!=neighbors.end(); it++)
+		h += point.dist(*it);
 
-   //          glm::vec3 pp = (*it).p();
+	return true;
+}
+
+template<typename S>
+bool rimls_vertex(const glm::tvec3<S>& X, const BasicNeighborIndex<S>& index, const RimlsParams& params, BasicRimlsKernel<S> kernel, 
+	BasicFieldSample<S>& sample){
+
+	std::vector<BasicData<S> > neighbors;
+	S h;
 
-   //          if(pp.x > maxi)
-   //              maxi = pp.x;
-   //          if(pp.y > maxi)
-   //              maxi = pp.y;
-   //          if(pp.z > maxi)
-   //              maxi = pp.z;
+	if(!rimls_support(X, index, params, neighbors, h)){
+		sample = BasicFieldSample<S>(NAN, glm::tvec3<S>(0.0, 0.0, 0.0));
+		return false;
+	}
 
-   //          if(pp.x < mini)
-   //              mini = pp.x;
-   //          if(pp.y < mini)
-   //              mini = pp.y;
-   //          if(pp.z < mini)
-   //              mini = pp.z;
-   //      }
+	glm::tvec3<S> grad_f;
+	S f = kernel(X, neighbors.data(), int(neighbors.size()), h, params.sigma_r, params.sigma_n, params.max_iter, grad_f);
 
-        //std::cout << "n " << "max " << maxi << " min " << mini << " h " << h << " hx " << hx << " counter " << counter << " counterx " << counterx << std::endl;
-        ////////////////////////////////////////////////////
+	sample = BasicFieldSample<S>(f, grad_f);
+	return !std::isnan(f);
+}
 
-		h = h / float(counter) * 2.0;
+// vertices of cells (packed keys) not already in field, sorted
+template<typename S>
+static void missing_vertices(const std::vector<uint64_t>& cells, const BasicScalarField<S>& field, std::vector<uint64_t>& missing){
 
-		// std::cout << counter << std::endl;
-		// printf("\n");
+	for(std::vector<uint64_t>::const_iterator it=cells.begin(); it!=cells.end(); it++){
+		LatticeKey C = unpack_key(*it);
 
-		cube.add_field(k, rimls_step(point.p(), testx, hx, sigma_r, sigma_n, max_iter, n));
+		for(int k=0; k<8; k++){
+			uint64_t key = pack_key(LatticeKey(C.i + int(cube_vertices[k].x), C.j + int(cube_vertices[k].y), 
+				C.k + int(cube_vertices[k].z)));
+			if(!field.count(key))
+				missing.push_back(key);
+		}
 	}
 
-	return cube;
+	std::sort(missing.begin(), missing.end());
+	missing.erase(std::unique(missing.begin(), missing.end()), missing.end());
 }
 
-void rimls(const std::vector<Data>& V, std::vector<Cube>& grid, float radius, float grid_step, float sigma_r, float sigma_n, int max_neighbors, 
-	int max_iter){
+template<typename S>
+void rimls_lattice(const std::vector<uint64_t>& cells, const BasicLattice<S>& L, const BasicNeighborIndex<S>& index, 
+	const RimlsParams& params, BasicScalarField<S>& field){
 
-	Cube init_cube(V);
-	OctTree<Data>* OT = makeTree(V, init_cube);
+	C2S_TIMER("field");
 
-	int n = 0;
+	std::vector<uint64_t> missing;
+	missing_vertices(cells, field, missing);
 
-	for(std::vector<Data>::const_iterator it=V.begin(); it!=V.end(); it++){
-		grid.push_back(rimls_regular(*it, OT, init_cube, radius, grid_step, sigma_r, sigma_n, max_neighbors, max_iter, n));
+	// the index is only read, each vertex is evaluated on its own
+	std::vector<BasicFieldSample<S> > samples(missing.size());
+	BasicRimlsKernel<S> kernel = rimls_kernel<S>(params.max_neighbors, params.max_iter);
+	parallel_for(missing.size(), [&](size_t begin, size_t end){
+		for(size_t i=begin; i<end; i++)
+			rimls_vertex(L.vertex(unpack_key(missing[i])), index, params, kernel, samples[i]);
+	});
+
+	field.reserve(field.size() + missing.size());
+	for(size_t i=0; i<missing.size(); i++)
+		field[missing[i]] = samples[i];
+}
+
+template<typename S>
+void rimls_lattice(const std::vector<uint64_t>& cells, const BasicLattice<S>& L, OctTree<BasicData<S> >* OT, const BasicCube<S>& init_cube, 
+	const RimlsParams& params, BasicScalarField<S>& field){
+
+	rimls_lattice(cells, L, BasicOctTreeIndex<S>(OT, init_cube), params, field);
+}
+
+template<typename S>
+void rimls_sweep(const std::vector<uint64_t>& cells, const BasicLattice<S>& L, const BasicNeighborIndex<S>& index, 
+	const std::vector<RimlsParams>& sweep, std::vector<BasicScalarField<S> >& fields){
+
+	C2S_TIMER("field");
+
+	fields.assign(sweep.size(), BasicScalarField<S>());
+	if(sweep.empty())
+		return;
+
+	std::vector<uint64_t> missing;
+	missing_vertices(cells, fields[0], missing);
+
+	std::vector<BasicRimlsKernel<S> > kernels;
+	for(std::vector<RimlsParams>::const_iterator it=sweep.begin(); it!=sweep.end(); it++)
+		kernels.push_back(rimls_kernel<S>((*it).max_neighbors, (*it).max_iter));
+
+	// samples of vertex i for parameters t at i*sweep.size() + t
+	std::vector<BasicFieldSample<S> > samples(missing.size() * sweep.size());
+	parallel_for(missing.size(), [&](size_t begin, size_t end){
+		std::vector<BasicData<S> > neighbors;
+		for(size_t i=begin; i<end; i++){
+			glm::tvec3<S> X = L.vertex(unpack_key(missing[i]));
+			S h;
+			if(!rimls_support(X, index, sweep[0], neighbors, h)){
+				for(size_t t=0; t<sweep.size(); t++)
+					samples[i*sweep.size() + t] = BasicFieldSample<S>(NAN, glm::tvec3<S>(0.0, 0.0, 0.0));
+				continue;
+			}
+			for(size_t t=0; t<sweep.size(); t++){
+				glm::tvec3<S> grad_f;
+				S f = kernels[t](X, neighbors.data(), int(neighbors.size()), h, sweep[t].sigma_r, sweep[t].sigma_n, 
+					sweep[t].max_iter, grad_f);
+				samples[i*sweep.size() + t] = BasicFieldSample<S>(f, grad_f);
+			}
+		}
+	});
+
+	for(size_t t=0; t<sweep.size(); t++){
+		fields[t].reserve(missing.size());
+		for(size_t i=0; i<missing.size(); i++)
+			fields[t][missing[i]] = samples[i*sweep.size() + t];
 	}
+}
 
-	std::cout << "nb nan :" << n << " / " << V.size()*8 << std::endl;
 
-	delete OT;
-};
\ No newline at end of file
+template float phi(float t, float h);
+template double phi(double t, double h);
+template float dphi(float t, float h);
+template double dphi(double t, double h);
+
+template float rimls_step(const glm::vec3& point, const Data* neighbors, int n, float h, float sigma_r, float sigma_n, int max_iter, 
+	glm::vec3& grad_f);
+template double rimls_step(const glm::dvec3& point, const DataD* neighbors, int n, double h, double sigma_r, double sigma_n, 
+	int max_iter, glm::dvec3& grad_f);
+
+template RimlsKernel rimls_kernel<float>(int max_neighbors, int max_iter);
+template RimlsKernelD rimls_kernel<double>(int max_neighbors, int max_iter);
+
+template bool rimls_vertex(const glm::vec3& X, const NeighborIndex& index, const RimlsParams& params, RimlsKernel kernel, 
+	FieldSample& sample);
+template bool rimls_vertex(const glm::dvec3& X, const NeighborIndexD& index, const RimlsParams& params, RimlsKernelD kernel, 
+	FieldSampleD& sample);
+
+template bool rimls_support(const glm::vec3& X, const NeighborIndex& index, const RimlsParams& params, 
+	std::vector<Data>& neighbors, float& h);
+template bool rimls_support(const glm::dvec3& X, const NeighborIndexD& index, const RimlsParams& params, 
+	std::vector<DataD>& neighbors, double& h);
+
+template void rimls_lattice(const std::vector<uint64_t>& cells, const Lattice& L, const NeighborIndex& index, 
+	const RimlsParams& params, ScalarField& field);
+template void rimls_lattice(const std::vector<uint64_t>& cells, const LatticeD& L, const NeighborIndexD& index, 
+	const RimlsParams& params, ScalarFieldD& field);
+
+template void rimls_lattice(const std::vector<uint64_t>& cells, const Lattice& L, OctTree<Data>* OT, const Cube& init_cube, 
+	const RimlsParams& params, ScalarField& field);
+template void rimls_lattice(const std::vector<uint64_t>& cells, const LatticeD& L, OctTree<DataD>* OT, const CubeD& init_cube, 
+	const RimlsParams& params, ScalarFieldD& field);
+
+template void rimls_sweep(const std::vector<uint64_t>& cells, const Lattice& L, const NeighborIndex& index, 
+	const std::vector<RimlsParams>& sweep, std::vector<ScalarField>& fields);
+template void rimls_sweep(const std::vector<uint64_t>& cells, const LatticeD& L, const NeighborIndexD& index, 
+	const std::vector<RimlsParams>& sweep, std::vector<ScalarFieldD>& fields);
@@ -1,16 +1,107 @@
 #pragma once
 
 #include "data.h"
+#include "lattice.h"
+#include "neighbor_index.h"
 
 
 
-float phi(float t, float h);
-float dphi(float t, float h);
+// what to do at a vertex with less than 2 points within radius
+enum Fallback{
+	FALLBACK_SKIP,    // leave it outside support (NaN), the cells around it produce no triangles
+	FALLBACK_KNN      // use its max_neighbors nearest points, as long as they are within fallback_radius
+};
+
+// fallback of RimlsParams and of rimls_regular and rimls
+const Fallback default_fallback = FALLBACK_SKIP;
+const float default_fallback_radius = 0.4;
+
+// parameters of a reconstruction, defaults match main.cpp on a cloud normalized to the unit cube
+struct RimlsParams{
+	float radius;
+	float grid_step;
+	float sigma_r;
+	float sigma_n;
+	int max_neighbors;
+	int max_iter;
+	Fallback fallback;
+	float fallback_radius;
+
+	RimlsParams() : radius(0.1), grid_step(0.01), sigma_r(0.5), sigma_n(1.0), max_neighbors(10), max_iter(3), 
+		fallback(default_fallback), fallback_radius(default_fallback_radius) {}
+
+	// farthest a point used to evaluate a vertex may be from it, through the fallback if any
+	float reach() const { return (fallback == FALLBACK_KNN) ? glm::max(radius, fallback_radius) : radius; }
+};
+
+
+// templates below are instantiated for float and double (S), the precision of the whole lattice path:
+// Data/Cube/Lattice for float, DataD/CubeD/LatticeD for double
+
+template<typename S> S phi(S t, S h);
+template<typename S> S dphi(S t, S h);
 
 float rimls_step(const glm::vec3& point, const std::vector<Data>& neighbors, float h, float sigma_r, float sigma_n, int max_iter);
 
+// same as above, also returning the gradient of the implicit function at point
+float rimls_step(const glm::vec3& point, const std::vector<Data>& neighbors, float h, float sigma_r, float sigma_n, int max_iter, 
+	glm::vec3& grad_f);
+
+// same as above on the n neighbors starting at neighbors
+template<typename S>
+S rimls_step(const glm::tvec3<S>& point, const BasicData<S>* neighbors, int n, S h, S sigma_r, S sigma_n, int max_iter, 
+	glm::tvec3<S>& grad_f);
+
+// a version of rimls_step, picked once per run with rimls_kernel
+template<typename S>
+using BasicRimlsKernel = S (*)(const glm::tvec3<S>& point, const BasicData<S>* neighbors, int n, S h, S sigma_r, S sigma_n, 
+	int max_iter, glm::tvec3<S>& grad_f);
+
+typedef BasicRimlsKernel<float> RimlsKernel;
+typedef BasicRimlsKernel<double> RimlsKernelD;
+
+// rimls_step specialized for at most max_neighbors neighbors and max_iter iterations, with stack arrays and unrolled
+// loops, when the pair is a common one (8, 10, 16 or 20 neighbors, 1 to 5 iterations); rimls_step otherwise.
+// Both give the same results
+template<typename S = float>
+BasicRimlsKernel<S> rimls_kernel(int max_neighbors, int max_iter);
+
+// corners with less than 2 points within radius use their max_neighbors nearest points within fallback_radius
+// (FALLBACK_KNN) or are left outside support (FALLBACK_SKIP, NaN)
 Cube rimls_regular(const Data& D, OctTree<Data>* OT, Cube init_cube, float radius, float grid_step, float sigma_r, float sigma_n, int max_neighbors, 
-	int max_iter);
+	int max_iter, Fallback fallback = default_fallback, float fallback_radius = default_fallback_radius);
 
 void rimls(const std::vector<Data>& V, std::vector<Cube>& grid, float radius, float grid_step, float sigma_r, float sigma_n, int max_neighbors, 
-	int max_iter);
\ No newline at end of file
+	int max_iter, Fallback fallback = default_fallback, float fallback_radius = default_fallback_radius);
+
+
+// the max_neighbors nearest points of X within radius (or from the fallback), ordered by distance then
+// position, and the support size h of the kernel over them; false if fewer than 2 points support X
+template<typename S>
+bool rimls_support(const glm::tvec3<S>& X, const BasicNeighborIndex<S>& index, const RimlsParams& params, 
+	std::vector<BasicData<S> >& neighbors, S& h);
+
+// evaluate the implicit function at lattice vertex X from its max_neighbors nearest points within radius;
+// neighbors are ordered by distance then position so that the result only depends on the points
+// around X and not on the tree layout. Return false (NaN sample) if fewer than 2 points support X
+// with kernel = rimls_kernel<S>(params.max_neighbors, params.max_iter)
+template<typename S>
+bool rimls_vertex(const glm::tvec3<S>& X, const BasicNeighborIndex<S>& index, const RimlsParams& params, BasicRimlsKernel<S> kernel, 
+	BasicFieldSample<S>& sample);
+
+// evaluate the field at every vertex of cells (packed keys) not already in field, on parallel_threads() threads
+template<typename S>
+void rimls_lattice(const std::vector<uint64_t>& cells, const BasicLattice<S>& L, const BasicNeighborIndex<S>& index, 
+	const RimlsParams& params, BasicScalarField<S>& field);
+
+// same as above on an OctTree built by makeTree on init_cube
+template<typename S>
+void rimls_lattice(const std::vector<uint64_t>& cells, const BasicLattice<S>& L, OctTree<BasicData<S> >* OT, 
+	const BasicCube<S>& init_cube, const RimlsParams& params, BasicScalarField<S>& field);
+
+// evaluate the field of each parameters of sweep at every vertex of cells, into fields (one per parameters).
+// The neighbors of a vertex are gathered once, with the search parameters of sweep[0] (radius, max_neighbors,
+// fallback, fallback_radius), and shared by all the kernels: only sigma_r, sigma_n and max_iter may vary
+template<typename S>
+void rimls_sweep(const std::vector<uint64_t>& cells, const BasicLattice<S>& L, const BasicNeighborIndex<S>& index, 
+	const std::vector<RimlsParams>& sweep, std::vector<BasicScalarField<S> >& fields);
@@ -0,0 +1,251 @@
+// End-to-end benchmark on large synthetic scans
+//
+// usage: ScaleBenchmark [--shapes s,s,...] [--sizes n,n,...] [--threads n,n,...] [--noise sigma]
+//                       [--outliers fraction] [--tmp dir] [--save file] [--baseline file] [--threshold t]
+//
+// For each shape (sphere, torus, plane, box, cylinder), size and thread count, a scan is generated,
+// written to tmp as .obj, then reconstructed: load -> tree -> rimls -> extraction. Sizes may be written
+// 1e6. Results go to stdout as csv, one line per run:
+//
+//   shape,points,threads,load_s,tree_s,field_s,extract_s,total_s,points_per_s,triangles
+//
+// --save writes the same lines to file to serve as a baseline. With --baseline, every run found in
+// file is compared to it and the program fails if a run is slower than (1 + t) times its baseline
+// (t = 0.2 by default), or if its number of triangles moved by more than t. Runs missing from the
+// baseline are not compared.
+//
+// The parameters are scaled with the density of the scan (density_params in bench_utils.h).
+
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "data.h"
+#include "rimls.h"
+#include "lattice.h"
+#include "extract.h"
+#include "synthetic.h"
+#include "bench_utils.h"
+#include "parallel.h"
+
+
+struct RunResult{
+    double load, tree, field, extract;
+    size_t triangles;
+
+    double total() const { return load + tree + field + extract; }
+};
+
+// baseline runs, keyed by shape,points,threads
+typedef std::map<std::string, RunResult> Baseline;
+
+
+static std::string run_key(const std::string& shape, size_t points, int threads){
+    std::ostringstream key;
+    key << shape << "," << points << "," << threads;
+    return key.str();
+}
+
+
+static bool reconstruct(const char * path, RunResult& result){
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    std::vector<Data> V;
+    if(!loadOBJ(path, V) || V.size() < 2)
+        return false;
+    Cube bounding_cube(V);
+    for(std::vector<Data>::iterator it=V.begin(); it!=V.end(); it++)
+        *it = Data(((*it).p() - bounding_cube.origin) / bounding_cube.scale, (*it).n());
+    result.load = seconds_since(start);
+
+    RimlsParams params = density_params(V.size());
+
+    start = std::chrono::steady_clock::now();
+    Cube init_cube(V);
+    OctTree<Data>* OT = makeTree(V, init_cube);
+    result.tree = seconds_since(start);
+
+    start = std::chrono::steady_clock::now();
+    Lattice L(init_cube.origin, params.grid_step);
+    std::vector<uint64_t> cells;
+    const int bound = lattice_key_bias - 1;
+    activate_cells(V, L, 1, LatticeKey(-bound, -bound, -bound), LatticeKey(bound, bound, bound), cells);
+    ScalarField field;
+    rimls_lattice(cells, L, OT, init_cube, params, field);
+    result.field = seconds_since(start);
+
+    start = std::chrono::steady_clock::now();
+    Mesh mesh;
+    extract_mesh(L, cells, field, 0.0, mesh);
+    result.extract = seconds_since(start);
+    result.triangles = mesh.nb_triangles();
+
+    delete OT;
+    return true;
+}
+
+
+static bool load_baseline(const char * path, Baseline& baseline){
+
+    FILE * file = fopen(path, "r");
+    if(file == NULL){
+        printf("ERROR: cannot read baseline %s\n", path);
+        return false;
+    }
+
+    char line[512];
+    while(fgets(line, sizeof(line), file) != NULL){
+        char shape[64];
+        unsigned long points, triangles;
+        int threads;
+        double total, points_per_s;
+        RunResult R;
+        if(sscanf(line, "%63[^,],%lu,%d,%lf,%lf,%lf,%lf,%lf,%lf,%lu", shape, &points, &threads, &R.load, &R.tree,
+            &R.field, &R.extract, &total, &points_per_s, &triangles) != 10)
+            continue;    // header
+        R.triangles = triangles;
+        baseline[run_key(shape, points, threads)] = R;
+    }
+
+    fclose(file);
+    return true;
+}
+
+
+int main(int argc, char **argv)
+{
+    std::vector<std::string> shapes;
+    std::vector<size_t> sizes;
+    std::vector<size_t> threads;
+    float noise = 0.001;
+    float outliers = 0.001;
+    std::string tmp = ".";
+    const char * save = NULL;
+    const char * baseline_path = NULL;
+    double threshold = 0.2;
+
+    for(int i=1; i<argc; i++){
+        bool has_value = i+1 < argc;
+
+        if(strcmp(argv[i], "--shapes") == 0 && has_value)
+            split_list(argv[++i], shapes);
+        else if(strcmp(argv[i], "--sizes") == 0 && has_value)
+            split_list(argv[++i], sizes);
+        else if(strcmp(argv[i], "--threads") == 0 && has_value)
+            split_list(argv[++i], threads);
+        else if(strcmp(argv[i], "--noise") == 0 && has_value)
+            noise = atof(argv[++i]);
+        else if(strcmp(argv[i], "--outliers") == 0 && has_value)
+            outliers = atof(argv[++i]);
+        else if(strcmp(argv[i], "--tmp") == 0 && has_value)
+            tmp = argv[++i];
+        else if(strcmp(argv[i], "--save") == 0 && has_value)
+            save = argv[++i];
+        else if(strcmp(argv[i], "--baseline") == 0 && has_value)
+            baseline_path = argv[++i];
+        else if(strcmp(argv[i], "--threshold") == 0 && has_value)
+            threshold = atof(argv[++i]);
+        else{
+            printf("usage: %s [--shapes s,s,...] [--sizes n,n,...] [--threads n,n,...] [--noise sigma]\n", argv[0]);
+            printf("       [--outliers fraction] [--tmp dir] [--save file] [--baseline file] [--threshold t]\n");
+            return 1;
+        }
+    }
+
+    if(shapes.empty())
+        split_list("box,cylinder,sphere", shapes);
+    if(sizes.empty())
+        sizes.push_back(1000000);
+    if(threads.empty()){
+        threads.push_back(1);
+        if(std::thread::hardware_concurrency() > 1)
+            threads.push_back(std::thread::hardware_concurrency());
+    }
+
+    Baseline baseline;
+    if(baseline_path != NULL && !load_baseline(baseline_path, baseline))
+        return 1;
+
+    FILE * saved = NULL;
+    if(save != NULL){
+        saved = fopen(save, "w");
+        if(saved == NULL){
+            printf("ERROR: cannot write baseline %s\n", save);
+            return 1;
+        }
+    }
+
+    const char * header = "shape,points,threads,load_s,tree_s,field_s,extract_s,total_s,points_per_s,triangles\n";
+    printf("%s", header);
+    if(saved != NULL)
+        fprintf(saved, "%s", header);
+
+    int regressions = 0;
+
+    for(std::vector<std::string>::const_iterator shape=shapes.begin(); shape!=shapes.end(); shape++){
+        for(std::vector<size_t>::const_iterator size=sizes.begin(); size!=sizes.end(); size++){
+
+            size_t n = *size;
+            std::vector<Data> V;
+            if(!shape_cloud(*shape, n, V))
+                return 1;
+            add_scan_noise(V, noise, outliers);
+
+            std::string path = tmp + "/scan_" + *shape + "_" + std::to_string(n) + ".obj";
+            if(!saveOBJ(path.c_str(), V))
+                return 1;
+            std::vector<Data>().swap(V);
+
+            for(std::vector<size_t>::const_iterator t=threads.begin(); t!=threads.end(); t++){
+
+                int nb_threads = int(*t);
+                set_parallel_threads(nb_threads);
+
+                RunResult R;
+                if(!reconstruct(path.c_str(), R)){
+                    remove(path.c_str());
+                    return 1;
+                }
+
+                char line[512];
+                snprintf(line, sizeof(line), "%s,%lu,%d,%.4f,%.4f,%.4f,%.4f,%.4f,%.1f,%lu\n", shape->c_str(),
+                    (unsigned long)n, nb_threads, R.load, R.tree, R.field, R.extract, R.total(), double(n) / R.total(),
+                    (unsigned long)R.triangles);
+                printf("%s", line);
+                fflush(stdout);
+                if(saved != NULL)
+                    fprintf(saved, "%s", line);
+
+                Baseline::const_iterator found = baseline.find(run_key(*shape, n, nb_threads));
+                if(found == baseline.end())
+                    continue;
+
+                const RunResult& B = found->second;
+                if(R.total() > (1.0 + threshold) * B.total()){
+                    fprintf(stderr, "REGRESSION: %s %lu points %d threads took %.3fs, baseline %.3fs\n", shape->c_str(),
+                        (unsigned long)n, nb_threads, R.total(), B.total());
+                    regressions++;
+                }
+                if(std::fabs(double(R.triangles) - double(B.triangles)) > threshold * double(B.triangles)){
+                    fprintf(stderr, "REGRESSION: %s %lu points %d threads gave %lu triangles, baseline %lu\n",
+                        shape->c_str(), (unsigned long)n, nb_threads, (unsigned long)R.triangles,
+                        (unsigned long)B.triangles);
+                    regressions++;
+                }
+            }
+
+            remove(path.c_str());
+        }
+    }
+
+    if(saved != NULL)
+        fclose(saved);
+
+    set_parallel_threads(0);
+    return regressions > 0 ? 1 : 0;
+}
@@ -0,0 +1,348 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "sparse_field.h"
+#include "parallel.h"
+#include "stats.h"
+
+
+static const char sparse_field_magic[4] = {'C', '2', 'S', 'Z'};
+static const uint32_t sparse_field_version = 1;
+
+static const uint32_t sparse_nan_code = 65535;
+static const uint32_t sparse_max_code = 65534;
+
+static const uint64_t key_mask = (uint64_t(1) << lattice_key_bits) - 1;
+static const uint64_t local_mask = uint64_t(sparse_block_size - 1);
+
+
+uint64_t sparse_block(uint64_t key){
+    uint64_t i = key & key_mask;
+    uint64_t j = (key >> lattice_key_bits) & key_mask;
+    uint64_t k = key >> (2*lattice_key_bits);
+    return ((k >> sparse_block_bits) << (2*lattice_key_bits)) | ((j >> sparse_block_bits) << lattice_key_bits)
+        | (i >> sparse_block_bits);
+}
+
+// index of the vertex of packed key inside its block, x fastest
+static int sparse_local(uint64_t key){
+    uint64_t i = key & local_mask;
+    uint64_t j = (key >> lattice_key_bits) & local_mask;
+    uint64_t k = (key >> (2*lattice_key_bits)) & local_mask;
+    return int(i | (j << sparse_block_bits) | (k << (2*sparse_block_bits)));
+}
+
+// packed key of the vertex at index local inside block
+static uint64_t sparse_key(uint64_t block, int local){
+    uint64_t i = ((block & key_mask) << sparse_block_bits) | (uint64_t(local) & local_mask);
+    uint64_t j = (((block >> lattice_key_bits) & key_mask) << sparse_block_bits) | ((uint64_t(local) >> sparse_block_bits) & local_mask);
+    uint64_t k = ((block >> (2*lattice_key_bits)) << sparse_block_bits) | (uint64_t(local) >> (2*sparse_block_bits));
+    return (k << (2*lattice_key_bits)) | (j << lattice_key_bits) | i;
+}
+
+
+static void put_varint(uint32_t v, std::vector<char>& bytes){
+    while(v >= 0x80){
+        bytes.push_back(char((v & 0x7F) | 0x80));
+        v >>= 7;
+    }
+    bytes.push_back(char(v));
+}
+
+// false if the varint runs past end or over 32 bits
+static bool get_varint(const unsigned char *& p, const unsigned char * end, uint32_t& v){
+    v = 0;
+    for(int shift=0; shift<32; shift+=7){
+        if(p == end)
+            return false;
+        unsigned char b = *p++;
+        if(shift == 28 && (b & 0x70))
+            return false;
+        v |= uint32_t(b & 0x7F) << shift;
+        if(!(b & 0x80))
+            return true;
+    }
+    return false;
+}
+
+
+// samples of a block by index inside the block, NaN for none
+struct SparseBlock{
+    uint64_t block;
+    std::vector<std::pair<int, float> > samples;
+};
+
+static void encode_block(const SparseBlock& B, SparseBlockEntry& entry, std::vector<char>& payload){
+
+    float lo = INFINITY, hi = -INFINITY;
+    unsigned char mask[sparse_block_vertices / 8];
+    memset(mask, 0, sizeof(mask));
+    for(std::vector<std::pair<int, float> >::const_iterator it=B.samples.begin(); it!=B.samples.end(); it++){
+        mask[it->first >> 3] |= (unsigned char)(1 << (it->first & 7));
+        if(!std::isnan(it->second)){
+            lo = std::min(lo, it->second);
+            hi = std::max(hi, it->second);
+        }
+    }
+
+    entry.block = B.block;
+    entry.nb_samples = uint32_t(B.samples.size());
+    entry.min = (lo <= hi) ? lo : 0.0;
+    entry.quantum = (lo < hi) ? (hi - lo) / float(sparse_max_code) : 0.0;
+
+    payload.assign((const char *)mask, (const char *)mask + sizeof(mask));
+
+    uint32_t previous = 0;
+    for(std::vector<std::pair<int, float> >::const_iterator it=B.samples.begin(); it!=B.samples.end(); it++){
+        uint32_t code = sparse_nan_code;
+        if(!std::isnan(it->second)){
+            code = 0;
+            if(entry.quantum > 0.0)
+                code = uint32_t(std::min(float(sparse_max_code), std::floor((it->second - entry.min) / entry.quantum + float(0.5))));
+        }
+        int32_t delta = int32_t(code) - int32_t(previous);
+        put_varint((uint32_t(delta) << 1) ^ uint32_t(delta >> 31), payload);
+        previous = code;
+    }
+
+    entry.size = uint32_t(payload.size());
+}
+
+void encode_sparse_field(const Lattice& L, const ScalarField& field, std::vector<char>& bytes){
+
+    C2S_TIMER("sparse field");
+
+    // samples by block, then by index inside the block
+    struct Sample{
+        uint64_t block;
+        int local;
+        float value;
+    };
+    std::vector<Sample> sorted;
+    sorted.reserve(field.size());
+    for(ScalarField::const_iterator it=field.begin(); it!=field.end(); it++){
+        Sample S = {sparse_block(it->first), sparse_local(it->first), it->second.value};
+        sorted.push_back(S);
+    }
+    parallel_sort(sorted, [](const Sample& A, const Sample& B){
+        return A.block != B.block ? A.block < B.block : A.local < B.local;
+    });
+
+    std::vector<SparseBlock> blocks;
+    for(std::vector<Sample>::const_iterator it=sorted.begin(); it!=sorted.end(); it++){
+        if(blocks.empty() || blocks.back().block != (*it).block){
+            blocks.push_back(SparseBlock());
+            blocks.back().block = (*it).block;
+        }
+        blocks.back().samples.push_back(std::pair<int, float>((*it).local, (*it).value));
+    }
+
+    std::vector<SparseBlockEntry> entries(blocks.size());
+    std::vector<std::vector<char> > payloads(blocks.size());
+    parallel_for(blocks.size(), [&](size_t begin, size_t end){
+        for(size_t b=begin; b<end; b++)
+            encode_block(blocks[b], entries[b], payloads[b]);
+    });
+
+    SparseFieldHeader header;
+    memcpy(header.magic, sparse_field_magic, 4);
+    header.version = sparse_field_version;
+    header.nb_blocks = blocks.size();
+    header.nb_samples = field.size();
+    header.origin[0] = L.origin.x;
+    header.origin[1] = L.origin.y;
+    header.origin[2] = L.origin.z;
+    header.step = L.step;
+
+    uint64_t offset = sizeof(header) + entries.size() * sizeof(SparseBlockEntry);
+    for(size_t b=0; b<entries.size(); b++){
+        entries[b].offset = offset;
+        offset += entries[b].size;
+    }
+
+    bytes.clear();
+    bytes.reserve(offset);
+    bytes.insert(bytes.end(), (const char *)&header, (const char *)&header + sizeof(header));
+    bytes.insert(bytes.end(), (const char *)entries.data(), (const char *)(entries.data() + entries.size()));
+    for(size_t b=0; b<payloads.size(); b++)
+        bytes.insert(bytes.end(), payloads[b].begin(), payloads[b].end());
+}
+
+bool write_sparse_field(const char * path, const Lattice& L, const ScalarField& field){
+
+    std::vector<char> bytes;
+    encode_sparse_field(L, field, bytes);
+
+    FILE * file = fopen(path, "wb");
+    if(file == NULL){
+        printf("ERROR: cannot write sparse field %s\n", path);
+        return false;
+    }
+    bool ok = fwrite(bytes.data(), 1, bytes.size(), file) == bytes.size();
+    ok = (fclose(file) == 0) && ok;
+    if(!ok)
+        printf("ERROR: cannot write sparse field %s\n", path);
+    return ok;
+}
+
+
+SparseField::SparseField() : mapping(NULL), mapping_size(0), header(NULL), entries(NULL) {}
+
+SparseField::~SparseField(){
+    if(mapping != NULL)
+        munmap(mapping, mapping_size);
+}
+
+bool SparseField::load(const char * path){
+
+    int fd = open(path, O_RDONLY);
+    if(fd < 0)
+        return false;
+
+    struct stat st;
+    if(fstat(fd, &st) != 0 || size_t(st.st_size) < sizeof(SparseFieldHeader)){
+        close(fd);
+        return false;
+    }
+
+    void * map = mmap(NULL, size_t(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if(map == MAP_FAILED)
+        return false;
+
+    const SparseFieldHeader * H = (const SparseFieldHeader *)map;
+    const SparseBlockEntry * E = (const SparseBlockEntry *)(H + 1);
+    bool valid = memcmp(H->magic, sparse_field_magic, 4) == 0 && H->version == sparse_field_version
+        && sizeof(SparseFieldHeader) + H->nb_blocks * sizeof(SparseBlockEntry) <= size_t(st.st_size);
+    for(uint64_t b=0; valid && b<H->nb_blocks; b++)
+        valid = E[b].offset + E[b].size <= uint64_t(st.st_size) && E[b].size >= sparse_block_vertices / 8;
+    if(!valid){
+        printf("ERROR: %s is not a sparse field file\n", path);
+        munmap(map, size_t(st.st_size));
+        return false;
+    }
+
+    if(mapping != NULL)
+        munmap(mapping, mapping_size);
+    mapping = map;
+    mapping_size = size_t(st.st_size);
+    header = H;
+    entries = E;
+    return true;
+}
+
+Lattice SparseField::lattice() const{
+    return Lattice(glm::vec3(header->origin[0], header->origin[1], header->origin[2]), header->step);
+}
+
+size_t SparseField::find_block(uint64_t block) const{
+    const SparseBlockEntry * end = entries + nb_blocks();
+    const SparseBlockEntry * it = std::lower_bound(entries, end, block, [](const SparseBlockEntry& E, uint64_t b){
+        return E.block < b;
+    });
+    return (it != end && it->block == block) ? size_t(it - entries) : nb_blocks();
+}
+
+// samples of the b-th block in mask order, as (index inside the block, value); false if the payload
+// ends before the samples of its mask
+static bool decode_block(const char * base, const SparseBlockEntry& E, std::vector<std::pair<int, float> >& samples){
+
+    const unsigned char * mask = (const unsigned char *)(base + E.offset);
+    const unsigned char * p = mask + sparse_block_vertices / 8;
+    const unsigned char * end = mask + E.size;
+
+    samples.clear();
+    uint32_t code = 0;
+    for(int local=0; local<sparse_block_vertices; local++){
+        if(!(mask[local >> 3] & (1 << (local & 7))))
+            continue;
+        uint32_t zigzag;
+        if(!get_varint(p, end, zigzag))
+            return false;
+        code = uint32_t(int32_t(code) + (int32_t(zigzag >> 1) ^ -int32_t(zigzag & 1)));
+        float value = (code == sparse_nan_code) ? NAN : E.min + float(code) * E.quantum;
+        samples.push_back(std::pair<int, float>(local, value));
+    }
+    return true;
+}
+
+static void corrupt_block(const SparseBlockEntry& E){
+    printf("ERROR: sparse field block at offset %lu is corrupt\n", (unsigned long)E.offset);
+}
+
+bool SparseField::read_block(size_t b, ScalarField& field) const{
+
+    std::vector<std::pair<int, float> > samples;
+    if(!decode_block((const char *)mapping, entries[b], samples)){
+        corrupt_block(entries[b]);
+        return false;
+    }
+    for(std::vector<std::pair<int, float> >::const_iterator it=samples.begin(); it!=samples.end(); it++)
+        field[sparse_key(entries[b].block, it->first)] = FieldSample(it->second, glm::vec3(0.0, 0.0, 0.0));
+    return true;
+}
+
+bool SparseField::read_region(const LatticeKey& lo, const LatticeKey& hi, ScalarField& field) const{
+
+    if(hi.i <= lo.i || hi.j <= lo.j || hi.k <= lo.k)
+        return true;
+
+    uint64_t first = sparse_block(pack_key(lo));
+    uint64_t last = sparse_block(pack_key(LatticeKey(hi.i - 1, hi.j - 1, hi.k - 1)));
+    std::vector<std::pair<int, float> > samples;
+
+    for(uint64_t k=(first >> (2*lattice_key_bits)); k<=(last >> (2*lattice_key_bits)); k++){
+        for(uint64_t j=((first >> lattice_key_bits) & key_mask); j<=((last >> lattice_key_bits) & key_mask); j++){
+            for(uint64_t i=(first & key_mask); i<=(last & key_mask); i++){
+                uint64_t block = (k << (2*lattice_key_bits)) | (j << lattice_key_bits) | i;
+                size_t b = find_block(block);
+                if(b == nb_blocks())
+                    continue;
+
+                if(!decode_block((const char *)mapping, entries[b], samples)){
+                    corrupt_block(entries[b]);
+                    return false;
+                }
+                for(std::vector<std::pair<int, float> >::const_iterator it=samples.begin(); it!=samples.end(); it++){
+                    uint64_t key = sparse_key(block, it->first);
+                    LatticeKey K = unpack_key(key);
+                    if(K.i >= lo.i && K.i < hi.i && K.j >= lo.j && K.j < hi.j && K.k >= lo.k && K.k < hi.k)
+                        field[key] = FieldSample(it->second, glm::vec3(0.0, 0.0, 0.0));
+                }
+            }
+        }
+    }
+    return true;
+}
+
+bool SparseField::read_all(ScalarField& field) const{
+
+    C2S_TIMER("sparse field");
+
+    // blocks are decoded in parallel, the field is filled in order
+    std::vector<std::vector<std::pair<int, float> > > samples(nb_blocks());
+    std::vector<char> decoded(nb_blocks());
+    parallel_for(nb_blocks(), [&](size_t begin, size_t end){
+        for(size_t b=begin; b<end; b++)
+            decoded[b] = decode_block((const char *)mapping, entries[b], samples[b]);
+    });
+    for(size_t b=0; b<nb_blocks(); b++){
+        if(!decoded[b]){
+            corrupt_block(entries[b]);
+            return false;
+        }
+    }
+
+    field.reserve(field.size() + nb_samples());
+    for(size_t b=0; b<nb_blocks(); b++){
+        for(std::vector<std::pair<int, float> >::const_iterator it=samples[b].begin(); it!=samples[b].end(); it++)
+            field[sparse_key(entries[b].block, it->first)] = FieldSample(it->second, glm::vec3(0.0, 0.0, 0.0));
+    }
+    return true;
+}
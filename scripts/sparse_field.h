@@ -0,0 +1,85 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "lattice.h"
+
+
+
+// Block based file format for an evaluated ScalarField, readable by block without decoding the rest.
+//
+// The lattice is cut into blocks of 8x8x8 vertices. A file holds a header, the directory of the non
+// empty blocks sorted by block key, then the payload of each block: a 64 byte mask of the vertices
+// present (x fastest), then their values quantized on 16 bits over the range of the block, as
+// zigzag varint deltas in mask order. Code 65535 marks a vertex without support (NaN). Offsets are
+// relative to the start of the file, which can be mapped at any address. Gradients are not stored, so
+// the field can be extracted again by marching cubes but not by dual contouring (dual_contour.h).
+const int sparse_block_bits = 3;
+const int sparse_block_size = 1 << sparse_block_bits;
+const int sparse_block_vertices = sparse_block_size * sparse_block_size * sparse_block_size;
+
+struct SparseFieldHeader{
+    char magic[4];          // "C2SZ"
+    uint32_t version;
+    uint64_t nb_blocks;
+    uint64_t nb_samples;
+    float origin[3];        // lattice of the field
+    float step;
+};
+
+struct SparseBlockEntry{
+    uint64_t block;         // sparse_block of its vertices
+    uint64_t offset;        // of the payload
+    uint32_t size;          // of the payload, in bytes
+    uint32_t nb_samples;
+    float min;              // value of code 0
+    float quantum;          // value step between codes, values are within quantum/2 of the original
+};
+
+// key of the block holding the vertex of packed key
+uint64_t sparse_block(uint64_t key);
+
+// the file for the field of lattice L, into bytes
+void encode_sparse_field(const Lattice& L, const ScalarField& field, std::vector<char>& bytes);
+
+bool write_sparse_field(const char * path, const Lattice& L, const ScalarField& field);
+
+
+// sparse field file mapped in memory, blocks are decoded on demand
+class SparseField{
+
+    void * mapping;
+    size_t mapping_size;
+    const SparseFieldHeader * header;
+    const SparseBlockEntry * entries;
+
+public:
+
+    SparseField();
+    ~SparseField();
+
+    SparseField(const SparseField&) = delete;
+    SparseField& operator=(const SparseField&) = delete;
+
+    // map the file at path, return false if it is missing or not a sparse field file
+    bool load(const char * path);
+
+    Lattice lattice() const;
+    size_t nb_blocks() const { return header ? header->nb_blocks : 0; }
+    size_t nb_samples() const { return header ? header->nb_samples : 0; }
+    size_t file_size() const { return mapping_size; }
+    const SparseBlockEntry& entry(size_t b) const { return entries[b]; }
+
+    // index in the directory of the block of given key, nb_blocks() if it is empty
+    size_t find_block(uint64_t block) const;
+
+    // reads return false if a block they decode is corrupt (its payload ends before the samples of its mask)
+
+    // add the samples of the b-th block of the directory to field
+    bool read_block(size_t b, ScalarField& field) const;
+    // add the samples of the vertices of [lo, hi) to field, decoding only the blocks they fall in
+    bool read_region(const LatticeKey& lo, const LatticeKey& hi, ScalarField& field) const;
+    // every sample, blocks decoded on parallel_threads() threads
+    bool read_all(ScalarField& field) const;
+};
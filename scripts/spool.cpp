@@ -0,0 +1,416 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "spool.h"
+#include "mesh_writer.h"
+
+
+static const char job_magic[4] = {'C', '2', 'S', 'K'};
+static const char piece_magic[4] = {'C', '2', 'S', 'M'};
+
+// a worker crashing more often than this per worker started makes the coordinator give up
+static const int max_crashes_per_worker = 3;
+
+
+static bool exists(const std::string& path){
+    struct stat st;
+    return stat(path.c_str(), &st) == 0;
+}
+
+// names of the files of dir ending with suffix, sorted
+static void list_files(const std::string& dir, const char * suffix, std::vector<std::string>& names){
+    names.clear();
+    DIR * d = opendir(dir.c_str());
+    if( d == NULL )
+        return;
+
+    size_t n = strlen(suffix);
+    struct dirent * entry;
+    while((entry = readdir(d)) != NULL){
+        std::string name(entry->d_name);
+        if(name.size() > n && name.compare(name.size() - n, n, suffix) == 0)
+            names.push_back(name);
+    }
+    closedir(d);
+    std::sort(names.begin(), names.end());
+}
+
+// remove the files of dir
+static void clear_dir(const std::string& dir){
+    std::vector<std::string> names;
+    list_files(dir, "", names);
+    for(std::vector<std::string>::const_iterator it=names.begin(); it!=names.end(); it++){
+        if(*it != "." && *it != "..")
+            remove((dir + "/" + *it).c_str());
+    }
+}
+
+// write to a temporary name then rename, so that readers never see a partial file
+static bool publish(const std::string& tmp, const std::string& path){
+    if(rename(tmp.c_str(), path.c_str()) != 0){
+        printf("ERROR: could not publish %s\n", path.c_str());
+        return false;
+    }
+    return true;
+}
+
+
+bool write_job(const char * path, const Job& job){
+    FILE * file = fopen(path, "wb");
+    if( file == NULL ){
+        printf("Impossible to open the file !\n");
+        return false;
+    }
+
+    int keys[9] = {job.brick.index.i, job.brick.index.j, job.brick.index.k,
+                   job.brick.lo.i, job.brick.lo.j, job.brick.lo.k,
+                   job.brick.hi.i, job.brick.hi.j, job.brick.hi.k};
+    float lattice[4] = {job.lattice.origin.x, job.lattice.origin.y, job.lattice.origin.z, job.lattice.step};
+    float values[6] = {job.params.radius, job.params.grid_step, job.params.sigma_r, job.params.sigma_n,
+                       job.params.fallback_radius, job.target};
+    int counts[5] = {job.params.max_neighbors, job.params.max_iter, int(job.params.fallback), job.dilation,
+                     int(job.dual_contouring)};
+    unsigned int length = job.brick.points_file.size();
+
+    bool ok = fwrite(job_magic, 1, 4, file) == 4
+        && fwrite(keys, sizeof(int), 9, file) == 9
+        && fwrite(lattice, sizeof(float), 4, file) == 4
+        && fwrite(values, sizeof(float), 6, file) == 6
+        && fwrite(counts, sizeof(int), 5, file) == 5
+        && fwrite(&length, sizeof(unsigned int), 1, file) == 1
+        && fwrite(job.brick.points_file.c_str(), 1, length, file) == length;
+
+    fclose(file);
+    return ok;
+}
+
+bool read_job(const char * path, Job& job){
+    FILE * file = fopen(path, "rb");
+    if( file == NULL ){
+        printf("Impossible to open the file !\n");
+        return false;
+    }
+
+    char magic[4];
+    int keys[9];
+    float lattice[4];
+    float values[6];
+    int counts[5];
+    unsigned int length = 0;
+
+    bool ok = fread(magic, 1, 4, file) == 4 && memcmp(magic, job_magic, 4) == 0
+        && fread(keys, sizeof(int), 9, file) == 9
+        && fread(lattice, sizeof(float), 4, file) == 4
+        && fread(values, sizeof(float), 6, file) == 6
+        && fread(counts, sizeof(int), 5, file) == 5
+        && fread(&length, sizeof(unsigned int), 1, file) == 1
+        && length < 4096;
+
+    std::vector<char> name(length);
+    ok = ok && fread(name.data(), 1, length, file) == length;
+    fclose(file);
+
+    if(!ok){
+        printf("ERROR: %s is not a job file\n", path);
+        return false;
+    }
+
+    job.brick.index = LatticeKey(keys[0], keys[1], keys[2]);
+    job.brick.lo = LatticeKey(keys[3], keys[4], keys[5]);
+    job.brick.hi = LatticeKey(keys[6], keys[7], keys[8]);
+    job.brick.nb_points = 0;
+    job.brick.points_file = std::string(name.begin(), name.end());
+    job.lattice = Lattice(glm::vec3(lattice[0], lattice[1], lattice[2]), lattice[3]);
+    job.params.radius = values[0];
+    job.params.grid_step = values[1];
+    job.params.sigma_r = values[2];
+    job.params.sigma_n = values[3];
+    job.params.fallback_radius = values[4];
+    job.target = values[5];
+    job.params.max_neighbors = counts[0];
+    job.params.max_iter = counts[1];
+    job.params.fallback = Fallback(counts[2]);
+    job.dilation = counts[3];
+    job.dual_contouring = counts[4] != 0;
+    return true;
+}
+
+
+bool write_piece(const char * path, const Mesh& mesh){
+    FILE * file = fopen(path, "wb");
+    if( file == NULL ){
+        printf("Impossible to open the file !\n");
+        return false;
+    }
+
+    uint64_t counts[2] = {mesh.nb_vertices(), mesh.triangles.size()};
+    size_t n = mesh.nb_vertices();
+
+    bool ok = fwrite(piece_magic, 1, 4, file) == 4
+        && fwrite(counts, sizeof(uint64_t), 2, file) == 2;
+    for(size_t i=0; ok && i<n; i++){
+        float buffer[6] = {mesh.vertices[i].x, mesh.vertices[i].y, mesh.vertices[i].z,
+                           mesh.normals[i].x, mesh.normals[i].y, mesh.normals[i].z};
+        ok = fwrite(buffer, sizeof(float), 6, file) == 6;
+    }
+    ok = ok && fwrite(mesh.keys.data(), sizeof(uint64_t), n, file) == n
+        && fwrite(mesh.triangles.data(), sizeof(unsigned int), mesh.triangles.size(), file) == mesh.triangles.size();
+
+    fclose(file);
+    return ok;
+}
+
+bool read_piece(const char * path, Mesh& mesh){
+    FILE * file = fopen(path, "rb");
+    if( file == NULL ){
+        printf("Impossible to open the file !\n");
+        return false;
+    }
+
+    char magic[4];
+    uint64_t counts[2];
+    bool ok = fread(magic, 1, 4, file) == 4 && memcmp(magic, piece_magic, 4) == 0
+        && fread(counts, sizeof(uint64_t), 2, file) == 2;
+
+    if(ok){
+        size_t n = counts[0];
+        mesh.vertices.resize(n);
+        mesh.normals.resize(n);
+        mesh.keys.resize(n);
+        mesh.triangles.resize(counts[1]);
+
+        for(size_t i=0; ok && i<n; i++){
+            float buffer[6];
+            ok = fread(buffer, sizeof(float), 6, file) == 6;
+            mesh.vertices[i] = glm::vec3(buffer[0], buffer[1], buffer[2]);
+            mesh.normals[i] = glm::vec3(buffer[3], buffer[4], buffer[5]);
+        }
+        ok = ok && fread(mesh.keys.data(), sizeof(uint64_t), n, file) == n
+            && fread(mesh.triangles.data(), sizeof(unsigned int), counts[1], file) == counts[1];
+    }
+
+    fclose(file);
+    if(!ok)
+        printf("ERROR: %s is not a mesh piece\n", path);
+    return ok;
+}
+
+
+// suffix of the jobs claimed by this process, unique across hosts
+static std::string worker_id(){
+    char host[256] = "localhost";
+    gethostname(host, sizeof(host) - 1);
+    char id[300];
+    sprintf(id, ".%s-%d", host, int(getpid()));
+    return std::string(id);
+}
+
+bool run_worker(const std::string& spool){
+
+    std::string id = worker_id();
+
+    while(true){
+
+        std::vector<std::string> jobs;
+        list_files(spool + "/jobs", ".job", jobs);
+
+        if(jobs.empty()){
+            if(exists(spool + "/posted"))
+                return true;
+            usleep(10000);
+            continue;
+        }
+
+        for(std::vector<std::string>::const_iterator it=jobs.begin(); it!=jobs.end(); it++){
+            std::string claimed = spool + "/claimed/" + *it + id;
+            if(rename((spool + "/jobs/" + *it).c_str(), claimed.c_str()) != 0)
+                continue;    // taken by another worker
+
+            Job job;
+            if(!read_job(claimed.c_str(), job))
+                return false;
+            job.brick.points_file = spool + "/" + job.brick.points_file;
+
+            TilingOptions options;
+            options.dilation = job.dilation;
+            options.target = job.target;
+            options.dual_contouring = job.dual_contouring;
+
+            Mesh mesh;
+            if(!reconstruct_brick(job.brick, job.lattice, job.params, options, mesh))
+                return false;
+
+            std::string name = (*it).substr(0, (*it).size() - 4);
+            std::string result = spool + "/results/" + name + ".mesh";
+            if(!write_piece((result + id).c_str(), mesh) || !publish(result + id, result))
+                return false;
+
+            remove(claimed.c_str());
+        }
+    }
+}
+
+
+// put back the jobs claimed by a worker that died
+static void requeue(const std::string& spool, const std::string& id){
+    std::vector<std::string> claimed;
+    list_files(spool + "/claimed", id.c_str(), claimed);
+    for(std::vector<std::string>::const_iterator it=claimed.begin(); it!=claimed.end(); it++){
+        std::string job = (*it).substr(0, (*it).size() - id.size());
+        rename((spool + "/claimed/" + *it).c_str(), (spool + "/jobs/" + job).c_str());
+    }
+}
+
+static pid_t spawn_worker(const char * worker_exe, const std::string& spool){
+    pid_t pid = fork();
+    if(pid == 0){
+        execl(worker_exe, worker_exe, "--worker", spool.c_str(), (char*)NULL);
+        printf("ERROR: could not start worker %s\n", worker_exe);
+        _exit(1);
+    }
+    return pid;
+}
+
+bool run_coordinator(const char * path, const RimlsParams& params, const TilingOptions& options,
+    const std::string& spool, int nb_workers, const char * worker_exe){
+
+    const char * dirs[4] = {"/points", "/jobs", "/claimed", "/results"};
+    mkdir(spool.c_str(), 0755);
+    for(int d=0; d<4; d++)
+        mkdir((spool + dirs[d]).c_str(), 0755);
+    remove((spool + "/posted").c_str());
+    // whatever an earlier run left behind, e.g. pieces of an aborted run with other parameters
+    for(int d=1; d<4; d++)
+        clear_dir(spool + dirs[d]);
+
+    std::string spill = spool + "/cloud.points";
+    Cube bounding_cube;
+    size_t nb_points;
+
+    printf("loading point cloud\n");
+    if(!spill_cloud(path, spill.c_str(), bounding_cube, nb_points))
+        return false;
+
+    Lattice L(glm::vec3(0.0, 0.0, 0.0), params.grid_step);
+
+    TilingOptions partition = options;
+    partition.out_dir = spool + "/points";
+    partition.pipeline_depth = 0;    // workers reconstruct one brick at a time
+
+    std::vector<Brick> bricks;
+    int size = plan_bricks(spill.c_str(), bounding_cube, L, params, partition, bricks);
+    if(!fits_budget(bricks, partition))
+        printf("WARNING: memory budget too small, bricks of %d cells still exceed it\n", size);
+    if(!partition_bricks(spill.c_str(), bounding_cube, L, params, partition, size, bricks))
+        return false;
+    remove(spill.c_str());
+
+    // post jobs
+    std::vector<std::string> names;
+    for(std::vector<Brick>::const_iterator it=bricks.begin(); it!=bricks.end(); it++){
+        char name[64];
+        sprintf(name, "brick_%d_%d_%d", (*it).index.i, (*it).index.j, (*it).index.k);
+
+        Job job;
+        job.brick = *it;
+        job.brick.points_file = (*it).points_file.substr(spool.size() + 1);
+        job.lattice = L;
+        job.params = params;
+        job.dilation = options.dilation;
+        job.target = options.target;
+        job.dual_contouring = options.dual_contouring;
+
+        std::string posted = spool + "/jobs/" + name + ".job";
+        if(!write_job((posted + ".tmp").c_str(), job) || !publish(posted + ".tmp", posted))
+            return false;
+        names.push_back(name);
+    }
+    FILE * flag = fopen((spool + "/posted").c_str(), "w");
+    if( flag != NULL )
+        fclose(flag);
+
+    printf("%lu points, %lu jobs posted to %s\n", (unsigned long)nb_points, (unsigned long)names.size(), spool.c_str());
+
+    // run local workers until every piece is back, replacing the ones that crash
+    char host[256] = "localhost";
+    gethostname(host, sizeof(host) - 1);
+
+    std::vector<pid_t> workers;
+    for(int w=0; w<nb_workers; w++)
+        workers.push_back(spawn_worker(worker_exe, spool));
+
+    int crashes = 0;
+    while(true){
+        size_t done = 0;
+        for(std::vector<std::string>::const_iterator it=names.begin(); it!=names.end(); it++)
+            done += exists(spool + "/results/" + *it + ".mesh");
+        if(done == names.size())
+            break;
+
+        for(size_t w=0; w<workers.size(); w++){
+            int status;
+            if(waitpid(workers[w], &status, WNOHANG) != workers[w])
+                continue;
+            if(WIFEXITED(status) && WEXITSTATUS(status) == 0){
+                workers[w] = -1;
+                continue;
+            }
+
+            char id[300];
+            sprintf(id, ".%s-%d", host, int(workers[w]));
+            requeue(spool, id);
+
+            if(++crashes > max_crashes_per_worker * nb_workers){
+                printf("ERROR: workers keep failing, giving up\n");
+                return false;
+            }
+            workers[w] = spawn_worker(worker_exe, spool);
+        }
+        workers.erase(std::remove(workers.begin(), workers.end(), pid_t(-1)), workers.end());
+
+        usleep(10000);
+    }
+
+    for(size_t w=0; w<workers.size(); w++)
+        waitpid(workers[w], NULL, 0);
+
+    // weld pieces on their shared lattice edges
+    Mesh mesh;
+    std::unordered_map<uint64_t, unsigned int> index;
+    for(std::vector<std::string>::const_iterator it=names.begin(); it!=names.end(); it++){
+        std::string result = spool + "/results/" + *it + ".mesh";
+        Mesh piece;
+        if(!read_piece(result.c_str(), piece))
+            return false;
+        weld_mesh(mesh, piece, index);
+        remove(result.c_str());
+    }
+
+    for(std::vector<Brick>::const_iterator it=bricks.begin(); it!=bricks.end(); it++)
+        remove((*it).points_file.c_str());
+    remove((spool + "/posted").c_str());
+    for(int d=0; d<4; d++)
+        rmdir((spool + dirs[d]).c_str());
+
+    // the welded mesh has no border between pieces left to lock
+    decimate_piece(mesh, options);
+
+    for(std::vector<glm::vec3>::iterator v=mesh.vertices.begin(); v!=mesh.vertices.end(); v++)
+        *v = bounding_cube.origin + (*v) * bounding_cube.scale;
+
+    std::string mesh_path = options.out_dir + "/mesh." + (options.mesh_format.empty() ? "obj" : options.mesh_format);
+    bool saved = options.mesh_format.empty() ? saveOBJ(mesh_path.c_str(), mesh) : save_mesh(mesh_path.c_str(), mesh);
+    if(!saved)
+        return false;
+
+    printf("%lu vertices, %lu triangles written to %s\n", (unsigned long)mesh.nb_vertices(),
+        (unsigned long)mesh.nb_triangles(), mesh_path.c_str());
+    return true;
+}
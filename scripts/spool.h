@@ -0,0 +1,51 @@
+#pragma once
+
+#include <string>
+
+#include "rimls.h"
+#include "extract.h"
+#include "tiling.h"
+
+
+
+// Multi-process reconstruction through a spool directory.
+//
+// The coordinator partitions the cloud into bricks as in the out-of-core mode, then posts one job
+// per brick. Workers claim jobs by renaming them (atomic on a shared file system, so workers may run
+// on other hosts mounting the same spool), reconstruct the brick and post its mesh piece. The
+// coordinator welds the pieces on their shared lattice edges into a single mesh.
+//
+//   spool/points/    brick points, written by the coordinator
+//   spool/jobs/      posted jobs, <brick>.job
+//   spool/claimed/   jobs being processed, <brick>.job.<host>-<pid>
+//   spool/results/   mesh pieces, <brick>.mesh
+//   spool/posted     created once every job is posted, workers leave when no job is left
+//
+// Files are written in the byte order of the host, hosts sharing a spool must agree on it.
+
+
+// everything a worker needs to reconstruct one brick
+struct Job{
+    Brick brick;             // points_file is relative to the spool
+    Lattice lattice;
+    RimlsParams params;
+    int dilation;
+    float target;
+    bool dual_contouring;
+};
+
+bool write_job(const char * path, const Job& job);
+bool read_job(const char * path, Job& job);
+
+// mesh pieces: vertices, normals, lattice edge (or dual contouring cell) keys and triangles
+bool write_piece(const char * path, const Mesh& mesh);
+bool read_piece(const char * path, Mesh& mesh);
+
+// process jobs of spool until every job is posted and none is left
+bool run_worker(const std::string& spool);
+
+// reconstruct the cloud at path with nb_workers local processes running worker_exe --worker spool,
+// with nb_workers = 0 jobs are left to workers started by hand; the welded mesh is written to
+// options.out_dir/mesh.<options.mesh_format>, obj by default
+bool run_coordinator(const char * path, const RimlsParams& params, const TilingOptions& options,
+    const std::string& spool, int nb_workers, const char * worker_exe);
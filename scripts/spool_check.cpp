@@ -0,0 +1,160 @@
+// Check of the multi-process reconstruction against the single process one
+//
+// usage: SpoolCheck worker_exe cloud.obj [--tmp dir]
+//
+// The cloud is reconstructed by a coordinator (spool.h) over bricks of 6 MB, with 2 local workers started
+// as worker_exe (a Cloud2Surface executable) beforehand, as workers started by hand, then as a single
+// brick by reconstruct_tiled. The welded mesh must have the same triangles, at the same positions, as the
+// single brick. The spool is first left with the pieces of an aborted run, which must not end in the mesh.
+// The program fails if the meshes differ.
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "spool.h"
+
+
+typedef std::vector<std::string> Triangle;    // positions as written, starting with the smallest one
+
+// triangles of an .obj mesh, in a form that does not depend on the order of vertices and triangles
+static bool read_triangles(const std::string& path, std::vector<Triangle>& triangles){
+
+    std::ifstream file(path.c_str());
+    if(!file){
+        printf("ERROR: cannot read %s\n", path.c_str());
+        return false;
+    }
+
+    std::vector<std::string> positions;
+    std::string line;
+    while(std::getline(file, line)){
+        std::istringstream words(line);
+        std::string type;
+        words >> type;
+        if(type == "v"){
+            std::string x, y, z;
+            words >> x >> y >> z;
+            positions.push_back(x + " " + y + " " + z);
+        }
+        else if(type == "f"){
+            Triangle T;
+            for(int c=0; c<3; c++){
+                std::string vertex;
+                words >> vertex;
+                size_t v = size_t(atol(vertex.c_str()));
+                if(v == 0 || v > positions.size()){
+                    printf("ERROR: bad face in %s\n", path.c_str());
+                    return false;
+                }
+                T.push_back(positions[v - 1]);
+            }
+            std::rotate(T.begin(), std::min_element(T.begin(), T.end()), T.end());
+            triangles.push_back(T);
+        }
+    }
+
+    std::sort(triangles.begin(), triangles.end());
+    return true;
+}
+
+
+int main(int argc, char **argv)
+{
+    if(argc < 3){
+        printf("usage: %s worker_exe cloud.obj [--tmp dir]\n", argv[0]);
+        return 1;
+    }
+
+    std::string tmp = ".";
+    for(int i=3; i<argc; i++){
+        if(strcmp(argv[i], "--tmp") == 0 && i+1 < argc)
+            tmp = argv[++i];
+        else{
+            printf("ERROR: unknown option %s\n", argv[i]);
+            return 1;
+        }
+    }
+
+    std::string spool = tmp + "/spool_check";
+    std::string welded = tmp + "/spool_check_welded";
+    std::string single = tmp + "/spool_check_single";
+    mkdir(welded.c_str(), 0755);
+    mkdir(single.c_str(), 0755);
+
+    // an aborted run: a piece for each of the 2 x 2 x 2 bricks fandisk is cut into
+    mkdir(spool.c_str(), 0755);
+    mkdir((spool + "/jobs").c_str(), 0755);
+    mkdir((spool + "/claimed").c_str(), 0755);
+    mkdir((spool + "/results").c_str(), 0755);
+    remove((spool + "/posted").c_str());
+    Mesh stale;
+    stale.vertices.push_back(glm::vec3(0.0, 0.0, 0.0));
+    stale.normals.push_back(glm::vec3(0.0, 0.0, 1.0));
+    stale.keys.push_back(0);
+    for(int b=0; b<8; b++){
+        char name[64];
+        sprintf(name, "/results/brick_%d_%d_%d.mesh", b & 1, (b>>1) & 1, (b>>2) & 1);
+        if(!write_piece((spool + name).c_str(), stale))
+            return 1;
+    }
+
+    // workers wait for jobs until the coordinator has posted them all
+    pid_t workers[2];
+    for(int w=0; w<2; w++){
+        workers[w] = fork();
+        if(workers[w] == 0){
+            execl(argv[1], argv[1], "--worker", spool.c_str(), (char*)NULL);
+            printf("ERROR: could not start worker %s\n", argv[1]);
+            _exit(1);
+        }
+    }
+
+    RimlsParams params;
+
+    TilingOptions options;
+    options.memory_budget = 6 * 1024 * 1024;
+    options.out_dir = welded;
+    bool ok = run_coordinator(argv[2], params, options, spool, 0, argv[1]);
+    for(int w=0; w<2; w++)
+        waitpid(workers[w], NULL, 0);
+    if(!ok)
+        return 1;
+
+    options.memory_budget = 0;
+    options.out_dir = single;
+    if(!reconstruct_tiled(argv[2], params, options))
+        return 1;
+
+    std::vector<Triangle> A, B;
+    if(!read_triangles(welded + "/mesh.obj", A) || !read_triangles(single + "/brick_0_0_0.obj", B))
+        return 1;
+
+    if(A != B){
+        size_t common = 0;
+        for(size_t a=0, b=0; a<A.size() && b<B.size(); ){
+            if(A[a] < B[b]) a++;
+            else if(B[b] < A[a]) b++;
+            else{ common++; a++; b++; }
+        }
+        fprintf(stderr, "MISMATCH: %lu welded triangles, %lu single brick triangles, %lu in common\n",
+            (unsigned long)A.size(), (unsigned long)B.size(), (unsigned long)common);
+        return 1;
+    }
+
+    printf("%lu triangles, welded mesh identical to the single brick\n", (unsigned long)A.size());
+    remove((welded + "/mesh.obj").c_str());
+    remove((single + "/brick_0_0_0.obj").c_str());
+    rmdir(welded.c_str());
+    rmdir(single.c_str());
+    rmdir(spool.c_str());
+    return 0;
+}
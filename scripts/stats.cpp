@@ -0,0 +1,227 @@
+#include "stats.h"
+
+#ifdef C2S_STATS
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <new>
+#include <string>
+
+
+static const char * counter_names[NB_COUNTERS] = {
+    "nodes_visited",
+    "neighbor_queries",
+    "neighbors_found",
+    "fallback_searches",
+    "unsupported_vertices",
+    "nan_results",
+    "rimls_iterations",
+    "triangles_emitted"
+};
+
+std::atomic<uint64_t> stats_counters[NB_COUNTERS];
+
+static const int max_stages = 64;
+static StatsStage stages[max_stages];
+static int nb_stages = 0;
+static std::mutex stages_mutex;
+
+
+StatsStage* stats_stage(const char * name){
+
+    std::lock_guard<std::mutex> lock(stages_mutex);
+
+    for(int i=0; i<nb_stages; i++){
+        if(strcmp(stages[i].name, name) == 0)
+            return &stages[i];
+    }
+
+    // past the limit, stages are merged in the last one
+    if(nb_stages == max_stages){
+        stages[max_stages - 1].name = "other";
+        return &stages[max_stages - 1];
+    }
+
+    stages[nb_stages].name = name;
+    return &stages[nb_stages++];
+}
+
+
+#ifdef C2S_MEMTRACK
+
+thread_local StatsStage* stats_current_stage = nullptr;
+
+static StatsStage untagged = {"untagged"};
+static StatsStage total = {"total"};
+
+uint64_t stats_allocations(){
+    return total.allocations.load(std::memory_order_relaxed);
+}
+
+static void raise_peak(StatsStage* S, int64_t live){
+    int64_t peak = S->peak_bytes.load(std::memory_order_relaxed);
+    while(live > peak && !S->peak_bytes.compare_exchange_weak(peak, live, std::memory_order_relaxed))
+        ;
+}
+
+static void charge(StatsStage* S, size_t size){
+    S->allocations.fetch_add(1, std::memory_order_relaxed);
+    S->bytes.fetch_add(size, std::memory_order_relaxed);
+    raise_peak(S, S->live_bytes.fetch_add(int64_t(size), std::memory_order_relaxed) + int64_t(size));
+}
+
+// every block starts with the size requested and the stage it is charged to, padded so that the
+// pointer returned keeps the alignment of malloc
+struct BlockHeader{
+    size_t size;
+    StatsStage* stage;
+};
+
+static const size_t header_size = (sizeof(BlockHeader) + 15) / 16 * 16;
+
+static void* tracked_allocation(size_t size){
+
+    void* block = malloc(size + header_size);
+    if(block == NULL)
+        return NULL;
+
+    BlockHeader* H = (BlockHeader*)block;
+    H->size = size;
+    H->stage = (stats_current_stage != nullptr) ? stats_current_stage : &untagged;
+
+    charge(H->stage, size);
+    charge(&total, size);
+
+    return (char*)block + header_size;
+}
+
+static void tracked_free(void* p){
+
+    if(p == NULL)
+        return;
+
+    BlockHeader* H = (BlockHeader*)((char*)p - header_size);
+    H->stage->live_bytes.fetch_sub(int64_t(H->size), std::memory_order_relaxed);
+    total.live_bytes.fetch_sub(int64_t(H->size), std::memory_order_relaxed);
+
+    free(H);
+}
+
+void* operator new(size_t size){
+    void* p = tracked_allocation(size);
+    if(p == NULL)
+        throw std::bad_alloc();
+    return p;
+}
+
+void* operator new[](size_t size){
+    return operator new(size);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept{
+    return tracked_allocation(size);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept{
+    return tracked_allocation(size);
+}
+
+void operator delete(void* p) noexcept { tracked_free(p); }
+void operator delete[](void* p) noexcept { tracked_free(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { tracked_free(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { tracked_free(p); }
+
+#endif
+
+
+static void write_json(FILE * file){
+
+    fprintf(file, "{\n  \"stages\": [");
+    for(int i=0; i<nb_stages; i++){
+        fprintf(file, "%s\n    {\"name\": \"%s\", \"calls\": %llu, \"seconds\": %.6f", i ? "," : "", stages[i].name,
+            (unsigned long long)stages[i].calls.load(), double(stages[i].nanoseconds.load()) * 1e-9);
+#ifdef C2S_MEMTRACK
+        fprintf(file, ", \"allocations\": %llu, \"bytes\": %llu, \"peak_bytes\": %lld",
+            (unsigned long long)stages[i].allocations.load(), (unsigned long long)stages[i].bytes.load(),
+            (long long)stages[i].peak_bytes.load());
+#endif
+        fprintf(file, "}");
+    }
+    fprintf(file, "\n  ],\n  \"counters\": {");
+    for(int c=0; c<NB_COUNTERS; c++)
+        fprintf(file, "%s\n    \"%s\": %llu", c ? "," : "", counter_names[c], (unsigned long long)stats_counters[c].load());
+    fprintf(file, "\n  }");
+#ifdef C2S_MEMTRACK
+    fprintf(file, ",\n  \"memory\": {");
+    const StatsStage* summary[2] = {&untagged, &total};
+    for(int i=0; i<2; i++){
+        fprintf(file, "%s\n    \"%s\": {\"allocations\": %llu, \"bytes\": %llu, \"peak_bytes\": %lld}", i ? "," : "",
+            summary[i]->name, (unsigned long long)summary[i]->allocations.load(),
+            (unsigned long long)summary[i]->bytes.load(), (long long)summary[i]->peak_bytes.load());
+    }
+    fprintf(file, "\n  }");
+#endif
+    fprintf(file, "\n}\n");
+}
+
+static void write_csv(FILE * file){
+
+#ifdef C2S_MEMTRACK
+    fprintf(file, "kind,name,calls,value,allocations,bytes,peak_bytes\n");
+    for(int i=0; i<nb_stages; i++){
+        fprintf(file, "stage,%s,%llu,%.6f,%llu,%llu,%lld\n", stages[i].name, (unsigned long long)stages[i].calls.load(),
+            double(stages[i].nanoseconds.load()) * 1e-9, (unsigned long long)stages[i].allocations.load(),
+            (unsigned long long)stages[i].bytes.load(), (long long)stages[i].peak_bytes.load());
+    }
+    for(int c=0; c<NB_COUNTERS; c++)
+        fprintf(file, "counter,%s,,%llu,,,\n", counter_names[c], (unsigned long long)stats_counters[c].load());
+    const StatsStage* summary[2] = {&untagged, &total};
+    for(int i=0; i<2; i++){
+        fprintf(file, "memory,%s,,,%llu,%llu,%lld\n", summary[i]->name, (unsigned long long)summary[i]->allocations.load(),
+            (unsigned long long)summary[i]->bytes.load(), (long long)summary[i]->peak_bytes.load());
+    }
+#else
+    fprintf(file, "kind,name,calls,value\n");
+    for(int i=0; i<nb_stages; i++){
+        fprintf(file, "stage,%s,%llu,%.6f\n", stages[i].name, (unsigned long long)stages[i].calls.load(),
+            double(stages[i].nanoseconds.load()) * 1e-9);
+    }
+    for(int c=0; c<NB_COUNTERS; c++)
+        fprintf(file, "counter,%s,,%llu\n", counter_names[c], (unsigned long long)stats_counters[c].load());
+#endif
+}
+
+
+// writes the report when static objects are destroyed, after main returns or exit is called
+static struct StatsReport{
+
+    ~StatsReport(){
+
+        std::lock_guard<std::mutex> lock(stages_mutex);
+
+        const char * path = getenv("C2S_STATS_REPORT");
+        if(path == NULL || path[0] == '\0'){
+            write_json(stderr);
+            return;
+        }
+
+        FILE * file = fopen(path, "w");
+        if(file == NULL){
+            printf("ERROR: cannot write stats report %s\n", path);
+            return;
+        }
+
+        size_t length = strlen(path);
+        if(length >= 4 && strcmp(path + length - 4, ".csv") == 0)
+            write_csv(file);
+        else
+            write_json(file);
+
+        fclose(file);
+    }
+
+} stats_report;
+
+#endif
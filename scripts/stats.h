@@ -0,0 +1,110 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+
+
+// Instrumentation of the reconstruction: scoped timers per stage and event counters.
+//
+// Compiled in with -DC2S_STATS (cmake -DC2S_STATS=ON), the macros expand to nothing otherwise.
+// With it, a report is written when the process exits, to the file named by the C2S_STATS_REPORT
+// environment variable (csv if the name ends with .csv, json otherwise) or as json to stderr.
+// Stage times are inclusive: a stage timed inside another one is counted in both.
+//
+// With -DC2S_MEMTRACK as well (cmake -DC2S_MEMTRACK=ON, which implies C2S_STATS) the global operator
+// new and delete are replaced to count allocations, bytes and peak live bytes per stage. Memory is
+// charged to the innermost stage running on the thread that allocates it, and given back to that
+// same stage when freed; allocations outside any stage are reported as untagged.
+
+enum StatsCounter{
+    NODES_VISITED,        // inner octree nodes visited by neighbor searches
+    NEIGHBOR_QUERIES,
+    NEIGHBORS_FOUND,
+    FALLBACK_SEARCHES,    // nearest neighbor searches made when the radius holds less than 2 points
+    UNSUPPORTED_VERTICES, // vertices left outside support, with less than 2 points even after the fallback
+    NAN_RESULTS,          // implicit function evaluations giving NaN despite their support
+    RIMLS_ITERATIONS,
+    TRIANGLES_EMITTED,    // by march_cell and dual_contour
+    NB_COUNTERS
+};
+
+
+#if defined(C2S_MEMTRACK) && !defined(C2S_STATS)
+#define C2S_STATS
+#endif
+
+#ifdef C2S_STATS
+
+struct StatsStage{
+    const char * name;
+    std::atomic<uint64_t> calls;
+    std::atomic<uint64_t> nanoseconds;
+#ifdef C2S_MEMTRACK
+    std::atomic<uint64_t> allocations;
+    std::atomic<uint64_t> bytes;
+    std::atomic<int64_t> live_bytes;
+    std::atomic<int64_t> peak_bytes;
+#endif
+};
+
+// stage called name, registered on first use; sites using the same name share it
+StatsStage* stats_stage(const char * name);
+
+extern std::atomic<uint64_t> stats_counters[NB_COUNTERS];
+
+inline void stats_count(StatsCounter counter, uint64_t n){
+    stats_counters[counter].fetch_add(n, std::memory_order_relaxed);
+}
+
+#ifdef C2S_MEMTRACK
+// innermost stage of the calling thread, memory allocated now is charged to it
+extern thread_local StatsStage* stats_current_stage;
+
+// allocations made by the process so far
+uint64_t stats_allocations();
+#endif
+
+class ScopedTimer{
+
+    StatsStage* stage;
+    std::chrono::steady_clock::time_point start;
+#ifdef C2S_MEMTRACK
+    StatsStage* outer;
+#endif
+
+public:
+
+    ScopedTimer(StatsStage* S) : stage(S), start(std::chrono::steady_clock::now()) {
+#ifdef C2S_MEMTRACK
+        outer = stats_current_stage;
+        stats_current_stage = stage;
+#endif
+    }
+    ~ScopedTimer(){
+#ifdef C2S_MEMTRACK
+        stats_current_stage = outer;
+#endif
+        uint64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+        stage->calls.fetch_add(1, std::memory_order_relaxed);
+        stage->nanoseconds.fetch_add(ns, std::memory_order_relaxed);
+    }
+};
+
+#define C2S_STATS_CONCAT_(a, b) a##b
+#define C2S_STATS_CONCAT(a, b) C2S_STATS_CONCAT_(a, b)
+
+// time the rest of the enclosing scope as stage name
+#define C2S_TIMER(name) \
+    static StatsStage* C2S_STATS_CONCAT(c2s_stage_, __LINE__) = stats_stage(name); \
+    ScopedTimer C2S_STATS_CONCAT(c2s_timer_, __LINE__)(C2S_STATS_CONCAT(c2s_stage_, __LINE__))
+
+#define C2S_COUNT(counter, n) stats_count(counter, uint64_t(n))
+
+#else
+
+#define C2S_TIMER(name) ((void)0)
+#define C2S_COUNT(counter, n) ((void)0)
+
+#endif
@@ -0,0 +1,170 @@
+#include <cmath>
+#include <random>
+
+#include "synthetic.h"
+
+
+void sphere_cloud(size_t n, std::vector<Data>& V, unsigned int seed){
+
+    std::mt19937 generator(seed);
+    std::normal_distribution<float> gaussian(0.0, 1.0);
+
+    const glm::vec3 center(0.5, 0.5, 0.5);
+    V.reserve(V.size() + n);
+
+    while(n > 0){
+        // isotropic direction, drawn in sequence (the order of evaluation of arguments is unspecified)
+        glm::vec3 N;
+        N.x = gaussian(generator);
+        N.y = gaussian(generator);
+        N.z = gaussian(generator);
+        float norm = euclidean_norm(N);
+        if(norm < 1e-6)
+            continue;
+        N = N / norm;
+        V.push_back(Data(center + float(0.4)*N, N));
+        n--;
+    }
+}
+
+void torus_cloud(size_t n, std::vector<Data>& V, unsigned int seed){
+
+    std::mt19937 generator(seed);
+    std::uniform_real_distribution<float> angle(0.0, 2.0*M_PI);
+    std::uniform_real_distribution<float> uniform(0.0, 1.0);
+
+    const glm::vec3 center(0.5, 0.5, 0.5);
+    const float R = 0.3;
+    const float r = 0.1;
+    V.reserve(V.size() + n);
+
+    while(n > 0){
+        float u = angle(generator);
+        float v = angle(generator);
+        // the area element is proportional to R + r cos(v): rejection keeps the density uniform
+        if(uniform(generator) * (R + r) > R + r*std::cos(v))
+            continue;
+        glm::vec3 N(std::cos(v)*std::cos(u), std::cos(v)*std::sin(u), std::sin(v));
+        glm::vec3 X = center + glm::vec3(R*std::cos(u), R*std::sin(u), 0.0) + r*N;
+        V.push_back(Data(X, N));
+        n--;
+    }
+}
+
+void noisy_plane_cloud(size_t n, float sigma, std::vector<Data>& V, unsigned int seed){
+
+    std::mt19937 generator(seed);
+    std::uniform_real_distribution<float> side(0.1, 0.9);
+    std::normal_distribution<float> gaussian(0.0, 1.0);
+
+    V.reserve(V.size() + n);
+
+    for(size_t i=0; i<n; i++){
+        float x = side(generator);
+        float y = side(generator);
+        V.push_back(Data(glm::vec3(x, y, 0.5 + sigma*gaussian(generator)), glm::vec3(0.0, 0.0, 1.0)));
+    }
+}
+
+void box_cloud(size_t n, std::vector<Data>& V, unsigned int seed){
+
+    std::mt19937 generator(seed);
+    std::uniform_int_distribution<int> face(0, 5);
+    std::uniform_real_distribution<float> side(-0.3, 0.3);
+
+    const glm::vec3 center(0.5, 0.5, 0.5);
+    V.reserve(V.size() + n);
+
+    for(size_t i=0; i<n; i++){
+        int f = face(generator);
+        int axis = f / 2;
+        float sign = (f % 2 == 0) ? -1.0 : 1.0;
+
+        glm::vec3 X;
+        glm::vec3 N(0.0, 0.0, 0.0);
+        X[axis] = sign * float(0.3);
+        X[(axis + 1) % 3] = side(generator);
+        X[(axis + 2) % 3] = side(generator);
+        N[axis] = sign;
+        V.push_back(Data(center + X, N));
+    }
+}
+
+void cylinder_cloud(size_t n, std::vector<Data>& V, unsigned int seed){
+
+    std::mt19937 generator(seed);
+    std::uniform_real_distribution<float> uniform(0.0, 1.0);
+    std::uniform_real_distribution<float> angle(0.0, 2.0*M_PI);
+
+    const glm::vec3 center(0.5, 0.5, 0.5);
+    const float r = 0.25;
+    const float height = 0.6;
+    // share of the side in the total area, the rest is split between the two caps
+    const float side = (2.0*M_PI*r*height) / (2.0*M_PI*r*height + 2.0*M_PI*r*r);
+    V.reserve(V.size() + n);
+
+    for(size_t i=0; i<n; i++){
+        float pick = uniform(generator);
+        float u = angle(generator);
+
+        if(pick < side){
+            float z = (uniform(generator) - float(0.5)) * height;
+            glm::vec3 N(std::cos(u), std::sin(u), 0.0);
+            V.push_back(Data(center + r*N + glm::vec3(0.0, 0.0, z), N));
+        }
+        else{
+            // uniform on the disk
+            float rho = r * std::sqrt(uniform(generator));
+            float sign = (pick < side + (1.0 - side) / 2.0) ? -1.0 : 1.0;
+            glm::vec3 X(rho*std::cos(u), rho*std::sin(u), sign * height / float(2.0));
+            V.push_back(Data(center + X, glm::vec3(0.0, 0.0, sign)));
+        }
+    }
+}
+
+bool shape_cloud(const std::string& shape, size_t n, std::vector<Data>& V, unsigned int seed){
+
+    if(shape == "sphere")
+        sphere_cloud(n, V, seed);
+    else if(shape == "torus")
+        torus_cloud(n, V, seed);
+    else if(shape == "plane")
+        noisy_plane_cloud(n, 0.0, V, seed);
+    else if(shape == "box")
+        box_cloud(n, V, seed);
+    else if(shape == "cylinder")
+        cylinder_cloud(n, V, seed);
+    else{
+        printf("ERROR: unknown shape %s\n", shape.c_str());
+        return false;
+    }
+    return true;
+}
+
+void add_scan_noise(std::vector<Data>& V, float sigma, float outliers, unsigned int seed){
+
+    std::mt19937 generator(seed);
+    std::normal_distribution<float> gaussian(0.0, 1.0);
+    std::uniform_real_distribution<float> uniform(0.0, 1.0);
+
+    for(std::vector<Data>::iterator it=V.begin(); it!=V.end(); it++){
+
+        if(uniform(generator) < outliers){
+            glm::vec3 X;
+            X.x = uniform(generator);
+            X.y = uniform(generator);
+            X.z = uniform(generator);
+            glm::vec3 N;
+            do{
+                N.x = gaussian(generator);
+                N.y = gaussian(generator);
+                N.z = gaussian(generator);
+            } while(euclidean_norm(N) < 1e-6);
+            *it = Data(X, N / euclidean_norm(N));
+            continue;
+        }
+
+        if(sigma > 0.0)
+            *it = Data((*it).p() + sigma*gaussian(generator)*(*it).n(), (*it).n());
+    }
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "data.h"
+
+
+
+// synthetic clouds with their exact normals, centered on (0.5, 0.5, 0.5) inside the unit cube;
+// points are drawn from a generator seeded with seed so that a given cloud is always the same
+
+// sphere of radius 0.4
+void sphere_cloud(size_t n, std::vector<Data>& V, unsigned int seed = 0);
+
+// torus of axis z, radii 0.3 and 0.1
+void torus_cloud(size_t n, std::vector<Data>& V, unsigned int seed = 0);
+
+// square z = 0.5 of side 0.8, positions moved along z by a gaussian noise of deviation sigma
+void noisy_plane_cloud(size_t n, float sigma, std::vector<Data>& V, unsigned int seed = 0);
+
+// sharp edged primitives, as found on mechanical parts
+// cube of side 0.6
+void box_cloud(size_t n, std::vector<Data>& V, unsigned int seed = 0);
+// cylinder of axis z, radius 0.25 and height 0.6, with its caps
+void cylinder_cloud(size_t n, std::vector<Data>& V, unsigned int seed = 0);
+
+// any of the shapes above by name (sphere, torus, plane, box, cylinder), return false for an unknown name;
+// the plane gets no noise of its own
+bool shape_cloud(const std::string& shape, size_t n, std::vector<Data>& V, unsigned int seed = 0);
+
+// scanner artifacts on the points of V: each point is moved along its normal by a gaussian noise of
+// deviation sigma, then a fraction outliers of the points is replaced by points uniform in the unit
+// cube with random normals
+void add_scan_noise(std::vector<Data>& V, float sigma, float outliers, unsigned int seed = 0);
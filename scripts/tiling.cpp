@@ -0,0 +1,617 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <memory>
+#include <unordered_map>
+
+#include "tiling.h"
+#include "flat_tree.h"
+#include "kd_tree.h"
+#include "field_cache.h"
+#include "sparse_field.h"
+#include "mesh_writer.h"
+#include "dual_contour.h"
+#include "decimate.h"
+#include "pipeline.h"
+#include "stats.h"
+
+
+// at most this many brick files are open at once while partitioning
+static const size_t max_open_bricks = 256;
+
+// resolution of the point histogram used to size bricks
+static const int histogram_bins = 64;
+
+// threads extracting and writing mesh pieces in the pipeline, the other steps get one thread each
+static const int pipeline_extract_threads = 2;
+
+
+size_t tile_bytes_per_point(int pipeline_depth){
+    if(pipeline_depth <= 0)
+        return std::max(tile_point_bytes + tile_tree_bytes,
+            std::max(tile_tree_bytes + tile_field_bytes, tile_field_bytes + tile_mesh_bytes));
+
+    // a brick per thread of a step and depth bricks in each queue: the points of the loaded and the
+    // indexed ones, the trees of the indexed and the evaluated ones, the fields of the evaluated and the
+    // extracted ones
+    size_t depth = size_t(pipeline_depth);
+    size_t extract = size_t(pipeline_extract_threads);
+    return (depth + 2) * tile_point_bytes + (depth + 2) * tile_tree_bytes + (depth + 1 + extract) * tile_field_bytes
+        + extract * tile_mesh_bytes;
+}
+
+
+bool write_point(FILE * file, const Data& D){
+    float buffer[6] = {D.p().x, D.p().y, D.p().z, D.n().x, D.n().y, D.n().z};
+    return fwrite(buffer, sizeof(float), 6, file) == 6;
+}
+
+bool read_point(FILE * file, Data& D){
+    float buffer[6];
+    if(fread(buffer, sizeof(float), 6, file) != 6)
+        return false;
+    D = Data(glm::vec3(buffer[0], buffer[1], buffer[2]), glm::vec3(buffer[3], buffer[4], buffer[5]));
+    return true;
+}
+
+bool read_points(const char * path, std::vector<Data>& V){
+    FILE * file = fopen(path, "rb");
+    if( file == NULL ){
+        printf("Impossible to open the file !\n");
+        return false;
+    }
+
+    Data D;
+    while(read_point(file, D))
+        V.push_back(D);
+
+    fclose(file);
+    return true;
+}
+
+
+bool spill_cloud(const char * path, const char * spill, Cube& bounding_cube, size_t& nb_points){
+
+    C2S_TIMER("spill");
+
+    ObjReader reader(path);
+    if(!reader.is_open())
+        return false;
+
+    FILE * file = fopen(spill, "wb");
+    if( file == NULL ){
+        printf("Impossible to open the file !\n");
+        return false;
+    }
+
+    glm::vec3 low(0.0, 0.0, 0.0);
+    glm::vec3 high(0.0, 0.0, 0.0);
+    nb_points = 0;
+
+    Data D;
+    while(reader.next(D)){
+        for(int i=0; i<3; i++){
+            if(nb_points == 0 || D.p()[i] < low[i])
+                low[i] = D.p()[i];
+            if(nb_points == 0 || D.p()[i] > high[i])
+                high[i] = D.p()[i];
+        }
+        if(!write_point(file, D)){
+            printf("ERROR: could not write %s\n", spill);
+            fclose(file);
+            return false;
+        }
+        nb_points++;
+    }
+
+    fclose(file);
+
+    // same cube as Cube(const std::vector<Data>&), without holding the points
+    float scale = glm::max(high.z - low.z, glm::max(high.y - low.y, high.x - low.x));
+    glm::vec3 center = (low + high) / float(2.0);
+    bounding_cube = Cube(center - float(0.5)*scale*glm::vec3(1.0, 1.0, 1.0), scale);
+
+    return nb_points > 0;
+}
+
+Data normalize(const Data& D, const Cube& bounding_cube){
+    glm::vec3 p = (D.p() - bounding_cube.origin) / bounding_cube.scale;
+    glm::vec3 n = D.n() / float(euclidean_norm(D.n()));
+    return Data(p, n);
+}
+
+int halo_cells(const RimlsParams& params, const TilingOptions& options){
+    float width = glm::max(params.reach(), float(options.dilation) * params.grid_step);
+    return int(std::ceil(width / params.grid_step)) + 1;
+}
+
+
+static int floor_div(int a, int b){
+    return (a >= 0) ? a / b : -((-a + b - 1) / b);
+}
+
+// number of lattice cells covering the unit cube along each axis
+static int lattice_cells(const Lattice& L){
+    return int(std::floor(1.0 / L.step)) + 1;
+}
+
+// bricks of size cells along each axis starting at first, the last one takes what remains up to last
+static void make_bricks(int first, int last, int size, std::vector<Brick>& bricks){
+    int n = (last - first + size - 1) / size;
+
+    bricks.clear();
+    for(int k=0; k<n; k++){
+        for(int j=0; j<n; j++){
+            for(int i=0; i<n; i++){
+                Brick B;
+                B.index = LatticeKey(i, j, k);
+                B.lo = LatticeKey(first + i*size, first + j*size, first + k*size);
+                B.hi = LatticeKey(std::min(last, B.lo.i + size), std::min(last, B.lo.j + size), std::min(last, B.lo.k + size));
+                B.nb_points = 0;
+                bricks.push_back(B);
+            }
+        }
+    }
+}
+
+int plan_bricks(const char * spill, const Cube& bounding_cube, const Lattice& L, const RimlsParams& params,
+    const TilingOptions& options, std::vector<Brick>& bricks){
+
+    const int H = histogram_bins;
+    int first = -options.dilation;
+    int last = lattice_cells(L) + options.dilation;
+    int halo = halo_cells(params, options);
+
+    // summed volume table of the point histogram, so that any box of bins is counted in O(1)
+    std::vector<size_t> table((H+1)*(H+1)*(H+1), 0);
+    #define TABLE(i, j, k) table[((k)*(H+1) + (j))*(H+1) + (i)]
+
+    FILE * file = fopen(spill, "rb");
+    if( file != NULL ){
+        Data D;
+        while(read_point(file, D)){
+            glm::vec3 p = normalize(D, bounding_cube).p();
+            int b[3];
+            for(int a=0; a<3; a++)
+                b[a] = glm::max(0, glm::min(H-1, int(p[a]*H)));
+            TABLE(b[0]+1, b[1]+1, b[2]+1)++;
+        }
+        fclose(file);
+    }
+
+    for(int k=1; k<=H; k++)
+        for(int j=1; j<=H; j++)
+            for(int i=1; i<=H; i++)
+                TABLE(i, j, k) += TABLE(i-1, j, k) + TABLE(i, j-1, k) + TABLE(i, j, k-1)
+                    - TABLE(i-1, j-1, k) - TABLE(i-1, j, k-1) - TABLE(i, j-1, k-1) + TABLE(i-1, j-1, k-1);
+
+    size_t budget_points = options.memory_budget / tile_bytes_per_point(options.pipeline_depth);
+
+    int size = last - first;
+    int min_size = std::min(size, 2 * halo);
+
+    while(true){
+
+        make_bricks(first, last, size, bricks);
+        size_t largest = 0;
+
+        for(std::vector<Brick>::iterator it=bricks.begin(); it!=bricks.end(); it++){
+            int lo[3] = {(*it).lo.i - halo, (*it).lo.j - halo, (*it).lo.k - halo};
+            int hi[3] = {(*it).hi.i + halo, (*it).hi.j + halo, (*it).hi.k + halo};
+            int b0[3], b1[3];    // bins overlapping the brick and its halo, counted whole
+            for(int a=0; a<3; a++){
+                b0[a] = glm::max(0, glm::min(H-1, int(std::floor(lo[a]*L.step*H))));
+                b1[a] = glm::max(0, glm::min(H-1, int(std::floor(hi[a]*L.step*H))));
+            }
+            (*it).nb_points = TABLE(b1[0]+1, b1[1]+1, b1[2]+1)
+                - TABLE(b0[0], b1[1]+1, b1[2]+1) - TABLE(b1[0]+1, b0[1], b1[2]+1) - TABLE(b1[0]+1, b1[1]+1, b0[2])
+                + TABLE(b0[0], b0[1], b1[2]+1) + TABLE(b0[0], b1[1]+1, b0[2]) + TABLE(b1[0]+1, b0[1], b0[2])
+                - TABLE(b0[0], b0[1], b0[2]);
+            largest = std::max(largest, (*it).nb_points);
+        }
+
+        if(options.memory_budget == 0 || largest <= budget_points || size == min_size)
+            break;
+        size = std::max(min_size, (size + 1) / 2);
+    }
+    #undef TABLE
+
+    // drop bricks that cannot hold any point
+    std::vector<Brick> kept;
+    for(std::vector<Brick>::const_iterator it=bricks.begin(); it!=bricks.end(); it++){
+        if((*it).nb_points > 0)
+            kept.push_back(*it);
+    }
+    bricks.swap(kept);
+
+    return size;
+}
+
+bool fits_budget(const std::vector<Brick>& bricks, const TilingOptions& options){
+    size_t bytes = tile_bytes_per_point(options.pipeline_depth);
+    for(std::vector<Brick>::const_iterator it=bricks.begin(); it!=bricks.end(); it++){
+        if(options.memory_budget > 0 && (*it).nb_points * bytes > options.memory_budget)
+            return false;
+    }
+    return true;
+}
+
+
+bool partition_bricks(const char * spill, const Cube& bounding_cube, const Lattice& L, const RimlsParams& params,
+    const TilingOptions& options, int size, std::vector<Brick>& bricks){
+
+    C2S_TIMER("partition");
+
+    int halo = halo_cells(params, options);
+    int origin = -options.dilation;    // first cell of the brick grid
+
+    for(size_t first=0; first<bricks.size(); first+=max_open_bricks){
+        size_t last = std::min(bricks.size(), first + max_open_bricks);
+
+        std::vector<FILE*> files;
+        std::unordered_map<uint64_t, size_t> group;    // brick index -> brick of this group
+        LatticeKey low = bricks[first].index;
+        LatticeKey high = bricks[first].index;
+        for(size_t b=first; b<last; b++){
+            group[pack_key(bricks[b].index)] = b;
+            low = LatticeKey(std::min(low.i, bricks[b].index.i), std::min(low.j, bricks[b].index.j), std::min(low.k, bricks[b].index.k));
+            high = LatticeKey(std::max(high.i, bricks[b].index.i), std::max(high.j, bricks[b].index.j), std::max(high.k, bricks[b].index.k));
+            char name[64];
+            sprintf(name, "/brick_%d_%d_%d.points", bricks[b].index.i, bricks[b].index.j, bricks[b].index.k);
+            bricks[b].points_file = options.out_dir + name;
+            bricks[b].nb_points = 0;
+            files.push_back(fopen(bricks[b].points_file.c_str(), "wb"));
+            if( files.back() == NULL ){
+                printf("Impossible to open the file !\n");
+                for(size_t f=0; f+1<files.size(); f++)
+                    fclose(files[f]);
+                return false;
+            }
+        }
+
+        FILE * file = fopen(spill, "rb");
+        if( file == NULL ){
+            printf("Impossible to open the file !\n");
+            return false;
+        }
+
+        // a point goes to every brick whose cells, extended by the halo, contain the cell of the point
+        Data D;
+        while(read_point(file, D)){
+            Data P = normalize(D, bounding_cube);
+            LatticeKey C = L.cell(P.p());
+            int c[3] = {C.i - origin, C.j - origin, C.k - origin};
+            int t0[3] = {floor_div(c[0] - halo, size), floor_div(c[1] - halo, size), floor_div(c[2] - halo, size)};
+            int t1[3] = {floor_div(c[0] + halo, size), floor_div(c[1] + halo, size), floor_div(c[2] + halo, size)};
+            t0[0] = std::max(t0[0], low.i); t0[1] = std::max(t0[1], low.j); t0[2] = std::max(t0[2], low.k);
+            t1[0] = std::min(t1[0], high.i); t1[1] = std::min(t1[1], high.j); t1[2] = std::min(t1[2], high.k);
+
+            for(int k=t0[2]; k<=t1[2]; k++)
+                for(int j=t0[1]; j<=t1[1]; j++)
+                    for(int i=t0[0]; i<=t1[0]; i++){
+                        std::unordered_map<uint64_t, size_t>::const_iterator b = group.find(pack_key(LatticeKey(i, j, k)));
+                        if(b == group.end())
+                            continue;
+                        write_point(files[b->second - first], P);
+                        bricks[b->second].nb_points++;
+                    }
+        }
+        fclose(file);
+
+        for(size_t f=0; f<files.size(); f++)
+            fclose(files[f]);
+    }
+
+    return true;
+}
+
+
+// dir/brick_<i>_<j>_<k>.extension
+static std::string brick_file(const std::string& dir, const Brick& B, const char * extension){
+    char name[64];
+    sprintf(name, "/brick_%d_%d_%d.%s", B.index.i, B.index.j, B.index.k, extension);
+    return dir + name;
+}
+
+// a brick on its way through the steps of its reconstruction
+struct BrickTask{
+    const Brick* brick;
+    std::vector<Data> V;
+    Cube init_cube;
+    std::vector<uint64_t> cells;     // empty when the brick has too few points
+    uint64_t key;                    // of its field in the cache
+    bool evaluated;                  // field read from the cache
+    OctTree<Data>* OT;               // index over V, one of them
+    FlatTree* flat;
+    KdTree* kd;
+    ScalarField field;
+    size_t nb_triangles;             // of its mesh piece
+
+    explicit BrickTask(const Brick* B) : brick(B), key(0), evaluated(false), OT(NULL), flat(NULL), kd(NULL), nb_triangles(0) {}
+    ~BrickTask(){
+        delete OT;
+        delete flat;
+        delete kd;
+    }
+};
+
+// read the points of the brick and activate its cells, the field is read from the cache if it is there
+static bool load_brick(BrickTask& T, const Lattice& L, const RimlsParams& params, const TilingOptions& options){
+
+    const Brick& B = *T.brick;
+    if(!read_points(B.points_file.c_str(), T.V))
+        return false;
+
+    if(T.V.size() < 2)
+        return true;
+
+    // local tree over the brick and its halo, slightly enlarged so that no point lies on its border
+    T.init_cube = Cube(T.V);
+    float margin = 1e-4 * T.init_cube.scale + 1e-6;
+    T.init_cube.origin -= margin * glm::vec3(1.0, 1.0, 1.0);
+    T.init_cube.scale += 2.0 * margin;
+
+    // the quads of dual contouring on the lower faces of the brick join the vertices of the cells below
+    LatticeKey lo = B.lo;
+    if(options.dual_contouring)
+        lo = LatticeKey(lo.i - 1, lo.j - 1, lo.k - 1);
+    activate_cells(T.V, L, options.dilation, lo, B.hi, T.cells);
+
+    if(!options.cache_dir.empty()){
+        T.key = field_key(cloud_hash(T.V, T.init_cube), L, params, options.dilation, lo, B.hi);
+        T.evaluated = load_field(brick_file(options.cache_dir, B, "field").c_str(), T.key, T.field);
+    }
+    return true;
+}
+
+// build the tree over the points, or map it from the index directory; the points are released
+static bool index_brick(BrickTask& T, const TilingOptions& options){
+
+    if(T.cells.empty() || T.evaluated)
+        return true;
+
+    if(options.kd_tree)
+        T.kd = new KdTree(T.V, T.init_cube);
+    else if(options.index_dir.empty())
+        T.OT = makeTree(T.V, T.init_cube);
+    else{
+        std::string path = brick_file(options.index_dir, *T.brick, "index");
+        uint64_t hash = cloud_hash(T.V, T.init_cube);
+        T.flat = new FlatTree();
+        if(!T.flat->load(path.c_str(), hash)){
+            OctTree<Data>* OT = makeTree(T.V, T.init_cube);
+            T.flat->build(OT, T.init_cube, hash);
+            delete OT;
+            if(!T.flat->save(path.c_str()))
+                return false;
+        }
+    }
+
+    std::vector<Data>().swap(T.V);    // points now live in the tree
+    return true;
+}
+
+// evaluate the field over the cells and release the tree
+static bool evaluate_brick(BrickTask& T, const Lattice& L, const RimlsParams& params, const TilingOptions& options){
+
+    if(T.cells.empty())
+        return true;
+
+    if(!T.evaluated){
+        if(T.OT != NULL)
+            rimls_lattice(T.cells, L, T.OT, T.init_cube, params, T.field);
+        else if(T.kd != NULL)
+            rimls_lattice(T.cells, L, *T.kd, params, T.field);
+        else
+            rimls_lattice(T.cells, L, *T.flat, params, T.field);
+        delete T.OT;
+        delete T.flat;
+        delete T.kd;
+        T.OT = NULL;
+        T.flat = NULL;
+        T.kd = NULL;
+
+        if(!options.cache_dir.empty() && !save_field(brick_file(options.cache_dir, *T.brick, "field").c_str(), T.key, T.field))
+            return false;
+    }
+
+    return !options.save_field || write_sparse_field(brick_file(options.out_dir, *T.brick, "sfield").c_str(), L, T.field);
+}
+
+static bool brick_field(BrickTask& T, const Lattice& L, const RimlsParams& params, const TilingOptions& options){
+    return load_brick(T, L, params, options) && index_brick(T, options) && evaluate_brick(T, L, params, options);
+}
+
+// contour the owned cells of the brick by dual contouring
+static void dual_contour_brick(const BrickTask& T, const Lattice& L, const TilingOptions& options, Mesh& mesh){
+    const Brick& B = *T.brick;
+    std::vector<uint64_t> owned;
+    for(std::vector<uint64_t>::const_iterator it=T.cells.begin(); it!=T.cells.end(); it++){
+        LatticeKey C = unpack_key(*it);
+        if(C.i >= B.lo.i && C.j >= B.lo.j && C.k >= B.lo.k)
+            owned.push_back(*it);
+    }
+    dual_contour(L, owned, T.field, options.target, mesh);
+}
+
+bool reconstruct_brick(const Brick& B, const Lattice& L, const RimlsParams& params, const TilingOptions& options,
+    Mesh& mesh){
+
+    C2S_TIMER("brick");
+
+    BrickTask T(&B);
+    if(!brick_field(T, L, params, options))
+        return false;
+
+    if(options.dual_contouring)
+        dual_contour_brick(T, L, options, mesh);
+    else
+        extract_mesh(L, T.cells, T.field, options.target, mesh);
+    return true;
+}
+
+bool reconstruct_brick(const Brick& B, const Lattice& L, const RimlsParams& params, const TilingOptions& options,
+    MeshWriter& writer){
+
+    C2S_TIMER("brick");
+
+    BrickTask T(&B);
+    if(!brick_field(T, L, params, options))
+        return false;
+
+    if(!options.dual_contouring)
+        return extract_mesh(L, T.cells, T.field, options.target, writer);
+
+    Mesh mesh;
+    dual_contour_brick(T, L, options, mesh);
+    if(mesh.nb_triangles() == 0)
+        return true;
+
+    MeshChunk chunk;
+    chunk.vertices = mesh.vertices;
+    chunk.normals = mesh.normals;
+    chunk.triangles = mesh.triangles;
+    for(std::vector<unsigned int>::const_iterator it=mesh.triangles.begin(); it!=mesh.triangles.end(); it++)
+        chunk.corners.push_back(mesh.vertices[*it]);
+    return writer.write(chunk);
+}
+
+// extract the mesh piece of a brick and write it to out_dir in the coordinates of the input cloud, nothing
+// is written for an empty piece. Dual contouring and decimation need the whole piece, which is then saved
+// in one go
+static bool save_brick(BrickTask& T, const Lattice& L, const Cube& bounding_cube, const TilingOptions& options){
+
+    C2S_TIMER("save brick");
+
+    if(!options.mesh_format.empty() && !options.dual_contouring && !options.decimating()){
+        // streamed to the file as it is extracted, empty pieces are removed afterwards
+        BufferedMeshWriter* writer = make_mesh_writer(options.mesh_format);
+        if(writer == NULL){
+            printf("ERROR: unknown mesh format %s\n", options.mesh_format.c_str());
+            return false;
+        }
+        writer->set_transform(bounding_cube.origin, bounding_cube.scale);
+        std::string piece = brick_file(options.out_dir, *T.brick, options.mesh_format.c_str());
+
+        bool ok = writer->begin(piece.c_str()) && extract_mesh(L, T.cells, T.field, options.target, *writer) && writer->end();
+        T.nb_triangles = writer->triangles();
+        if(ok && T.nb_triangles == 0)
+            remove(piece.c_str());
+        delete writer;
+        return ok;
+    }
+
+    Mesh mesh;
+    if(options.dual_contouring)
+        dual_contour_brick(T, L, options, mesh);
+    else
+        extract_mesh(L, T.cells, T.field, options.target, mesh);
+    decimate_piece(mesh, options);
+    T.nb_triangles = mesh.nb_triangles();
+    if(mesh.nb_triangles() == 0)
+        return true;
+
+    // back to the coordinates of the input cloud
+    for(std::vector<glm::vec3>::iterator v=mesh.vertices.begin(); v!=mesh.vertices.end(); v++)
+        *v = bounding_cube.origin + (*v) * bounding_cube.scale;
+
+    if(!options.mesh_format.empty())
+        return save_mesh(brick_file(options.out_dir, *T.brick, options.mesh_format.c_str()).c_str(), mesh);
+    return saveOBJ(brick_file(options.out_dir, *T.brick, "obj").c_str(), mesh);
+}
+
+
+void decimate_piece(Mesh& mesh, const TilingOptions& options){
+    if(!options.decimating())
+        return;
+    size_t target = (options.decimate_ratio < 1.0) ? size_t(double(options.decimate_ratio) * double(mesh.nb_triangles())) : 0;
+    decimate_mesh(mesh, target, options.max_error);
+}
+
+
+bool reconstruct_tiled(const char * path, const RimlsParams& params, const TilingOptions& options){
+
+    std::string spill = options.out_dir + "/cloud.points";
+    Cube bounding_cube;
+    size_t nb_points;
+
+    printf("loading point cloud\n");
+    if(!spill_cloud(path, spill.c_str(), bounding_cube, nb_points))
+        return false;
+
+    Lattice L(glm::vec3(0.0, 0.0, 0.0), params.grid_step);
+
+    // a pipeline holds several bricks at once, one too deep for the budget runs with shallower queues
+    TilingOptions planned = options;
+    std::vector<Brick> bricks;
+    int size = plan_bricks(spill.c_str(), bounding_cube, L, params, planned, bricks);
+    while(planned.pipeline_depth > 0 && !fits_budget(bricks, planned)){
+        planned.pipeline_depth--;
+        size = plan_bricks(spill.c_str(), bounding_cube, L, params, planned, bricks);
+    }
+    if(options.pipeline_depth > 0 && planned.pipeline_depth == 0)
+        printf("ERROR: memory budget too small for the pipeline, bricks are reconstructed one at a time\n");
+    else if(planned.pipeline_depth < options.pipeline_depth)
+        printf("WARNING: memory budget too small for a pipeline of depth %d, running it with depth %d\n",
+            options.pipeline_depth, planned.pipeline_depth);
+
+    size_t largest = 0;
+    for(std::vector<Brick>::const_iterator it=bricks.begin(); it!=bricks.end(); it++)
+        largest = std::max(largest, (*it).nb_points);
+
+    printf("%lu points, %lu bricks, at most %lu points per brick (~%lu MB in memory)\n", (unsigned long)nb_points,
+        (unsigned long)bricks.size(), (unsigned long)largest,
+        (unsigned long)(largest * tile_bytes_per_point(planned.pipeline_depth) >> 20));
+    if(!fits_budget(bricks, planned))
+        printf("WARNING: memory budget too small, bricks of %d cells still hold %lu points\n", size, (unsigned long)largest);
+
+    if(!partition_bricks(spill.c_str(), bounding_cube, L, params, options, size, bricks))
+        return false;
+    remove(spill.c_str());
+
+    size_t nb_triangles = 0;
+
+    if(planned.pipeline_depth > 0){
+        // steps of the reconstruction on their own threads, bricks passed along through bounded queues
+        std::atomic<size_t> triangles(0);
+        Pipeline<std::unique_ptr<BrickTask> > pipeline(size_t(planned.pipeline_depth));
+        pipeline.add_stage("load", 1, [&](std::unique_ptr<BrickTask>& T){
+            bool ok = load_brick(*T, L, params, options);
+            remove(T->brick->points_file.c_str());
+            return ok;
+        });
+        pipeline.add_stage("index", 1, [&](std::unique_ptr<BrickTask>& T){
+            return index_brick(*T, options);
+        });
+        pipeline.add_stage("evaluate", 1, [&](std::unique_ptr<BrickTask>& T){
+            return evaluate_brick(*T, L, params, options);
+        });
+        pipeline.add_stage("extract", pipeline_extract_threads, [&](std::unique_ptr<BrickTask>& T){
+            bool ok = save_brick(*T, L, bounding_cube, options);
+            triangles += T->nb_triangles;
+            return ok;
+        });
+
+        bool ok = pipeline.run(bricks.size(), [&](size_t b){
+            return std::unique_ptr<BrickTask>(new BrickTask(&bricks[b]));
+        });
+        pipeline.report(stdout);
+        if(!ok)
+            return false;
+        nb_triangles = triangles;
+    }
+    else{
+        for(std::vector<Brick>::const_iterator it=bricks.begin(); it!=bricks.end(); it++){
+            C2S_TIMER("brick");
+            BrickTask T(&(*it));
+            bool ok = brick_field(T, L, params, options);
+            remove((*it).points_file.c_str());
+            if(!ok || !save_brick(T, L, bounding_cube, options))
+                return false;
+            nb_triangles += T.nb_triangles;
+        }
+    }
+
+    printf("%lu triangles written to %s\n", (unsigned long)nb_triangles, options.out_dir.c_str());
+    return true;
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "rimls.h"
+#include "extract.h"
+
+
+
+// out-of-core reconstruction: the lattice is cut into bricks small enough for the memory budget,
+// each brick is reconstructed from its own points plus a halo of width RimlsParams::reach() and
+// written as its own mesh piece before the next one is loaded
+struct TilingOptions{
+    size_t memory_budget;    // bytes, 0 to reconstruct everything as a single brick
+    int dilation;            // lattice cells activated around each point
+    float target;            // iso-value to extract
+    std::string out_dir;     // where temporary point files and mesh pieces go
+    std::string index_dir;   // where brick trees are kept between runs, empty to rebuild them every run
+    bool kd_tree;            // index the points of each brick with a kd-tree (kd_tree.h) instead of an OctTree,
+                             // rebuilt every run
+    std::string cache_dir;   // where evaluated brick fields are kept between runs, empty to evaluate every run
+    bool save_field;         // also write the field of each brick to out_dir as a sparse field file
+    std::string mesh_format; // obj, ply or stl to stream mesh pieces to their file as they are extracted,
+                             // empty to extract each piece whole and save it as obj
+    bool dual_contouring;    // extract by dual contouring (dual_contour.h) instead of marching cubes
+    float decimate_ratio;    // fraction of the triangles of each mesh piece kept by decimation (decimate.h), 1 for all
+    float max_error;         // distance decimation may move the surface by, 0 for no bound
+    int pipeline_depth;      // > 0 to overlap the loading, indexing, evaluation and extraction of successive
+                             // bricks, on their own threads, with queues of that many bricks between them;
+                             // the bricks are then sized so that all those held at once fit in memory_budget
+
+    TilingOptions() : memory_budget(0), dilation(1), target(0.0), out_dir("."), kd_tree(false), save_field(false),
+        dual_contouring(false), decimate_ratio(1.0), max_error(0.0), pipeline_depth(0) {}
+
+    bool decimating() const { return decimate_ratio < 1.0 || max_error > 0.0; }
+};
+
+// estimated bytes per point of a brick held by each step of its reconstruction: points as read, tree over
+// them, active cells and field, mesh piece. Points are released once indexed, the tree once evaluated
+const size_t tile_point_bytes = 64;
+const size_t tile_tree_bytes = 64;
+const size_t tile_field_bytes = 384;
+const size_t tile_mesh_bytes = 128;
+
+// estimated peak bytes per point of a brick, for all the bricks held at once by a pipeline of that depth
+// (0 for bricks reconstructed one at a time)
+size_t tile_bytes_per_point(int pipeline_depth);
+
+
+// a block of lattice cells [lo, hi) and the points it needs
+struct Brick{
+    LatticeKey index;        // position of the brick in the brick grid
+    LatticeKey lo, hi;       // owned cells
+    size_t nb_points;        // points in the brick and its halo (estimated when planning)
+    std::string points_file;
+};
+
+
+// binary point files: 6 floats (position, normal) per point
+bool write_point(FILE * file, const Data& D);
+bool read_point(FILE * file, Data& D);
+bool read_points(const char * path, std::vector<Data>& V);
+
+// copy the .obj cloud at path into a binary point file and compute its bounding cube
+bool spill_cloud(const char * path, const char * spill, Cube& bounding_cube, size_t& nb_points);
+
+// points are reconstructed in the unit cube, as in main.cpp
+Data normalize(const Data& D, const Cube& bounding_cube);
+
+// width of the halo in lattice cells, enough for every neighbor search and cell activation of a brick
+int halo_cells(const RimlsParams& params, const TilingOptions& options);
+
+// cut the lattice covering the unit cube into the fewest bricks whose points fit in the memory budget,
+// as held by options.pipeline_depth, return the size of the bricks in cells. Bricks are not made smaller
+// than twice the halo, below which most of their points are halo: with too small a budget the largest
+// ones are left over it (see fits_budget)
+int plan_bricks(const char * spill, const Cube& bounding_cube, const Lattice& L, const RimlsParams& params,
+    const TilingOptions& options, std::vector<Brick>& bricks);
+
+// true if the points of each brick fit in the memory budget, as held by options.pipeline_depth
+bool fits_budget(const std::vector<Brick>& bricks, const TilingOptions& options);
+
+// write the normalized points of each brick and its halo to brick.points_file
+bool partition_bricks(const char * spill, const Cube& bounding_cube, const Lattice& L, const RimlsParams& params,
+    const TilingOptions& options, int size, std::vector<Brick>& bricks);
+
+// reconstruct the owned cells of a brick from its point file, mesh is in unit cube coordinates; with an
+// index_dir the tree of the brick is mapped from index_dir/brick_<i>_<j>_<k>.index when it was built from
+// the same points, else built and saved there. Likewise with a cache_dir the field is read from
+// cache_dir/brick_<i>_<j>_<k>.field when it was evaluated from the same points and parameters. With
+// save_field the field is written to out_dir/brick_<i>_<j>_<k>.sfield (see sparse_field.h). With
+// dual_contouring the layer of cells below the brick is evaluated as well, for the quads of its lower faces
+bool reconstruct_brick(const Brick& B, const Lattice& L, const RimlsParams& params, const TilingOptions& options,
+    Mesh& mesh);
+// same as above, the mesh going to writer (between its begin and end) as it is extracted, or whole once
+// contoured with dual_contouring
+bool reconstruct_brick(const Brick& B, const Lattice& L, const RimlsParams& params, const TilingOptions& options,
+    MeshWriter& writer);
+
+// decimate mesh as set by options (see decimate.h), with only max_error the triangle count is not bounded
+void decimate_piece(Mesh& mesh, const TilingOptions& options);
+
+// whole out-of-core pipeline, one mesh piece per non empty brick in options.out_dir
+bool reconstruct_tiled(const char * path, const RimlsParams& params, const TilingOptions& options);